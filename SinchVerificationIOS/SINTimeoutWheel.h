@@ -0,0 +1,23 @@
+#import <Foundation/Foundation.h>
+
+/**
+ * Hashed timer wheel shared by all verification calls. Deadlines are dropped
+ * into slots served by a single main queue timer, which only runs while
+ * something is pending, instead of one timer per call.
+ *
+ * Deadlines are accurate to one tick. Use from the main queue only.
+ */
+@interface SINTimeoutWheel : NSObject
+
++ (instancetype)sharedWheel;
+
+/**
+ * Schedules handler to run on the main queue after timeout seconds.
+ *
+ * @return a token that can be passed to -cancel:
+ */
+- (id)scheduleAfter:(NSTimeInterval)timeout handler:(dispatch_block_t)handler;
+
+- (void)cancel:(id)token;
+
+@end
@@ -0,0 +1,115 @@
+#import "SINTimeoutWheel.h"
+
+static const NSTimeInterval SINTimeoutWheelTick = 0.1;
+static const NSUInteger SINTimeoutWheelSlots = 64;
+
+@interface SINTimeout : NSObject
+
+@property (copy, nonatomic) dispatch_block_t handler;
+@property (assign, nonatomic) NSUInteger rounds;
+
+@end
+
+@implementation SINTimeout
+@end
+
+@interface SINTimeoutWheel ()
+
+@property (strong, nonatomic) NSArray<NSMutableArray<SINTimeout *> *> *slots;
+@property (strong, nonatomic) NSHashTable<SINTimeout *> *pending;
+@property (strong, nonatomic) dispatch_source_t timer;
+@property (assign, nonatomic) NSUInteger cursor;
+
+@end
+
+@implementation SINTimeoutWheel
+
++ (instancetype)sharedWheel {
+    static SINTimeoutWheel *wheel;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        wheel = [[SINTimeoutWheel alloc] init];
+    });
+    return wheel;
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        NSMutableArray *slots = [NSMutableArray arrayWithCapacity:SINTimeoutWheelSlots];
+        for (NSUInteger i = 0; i < SINTimeoutWheelSlots; i++) {
+            [slots addObject:[NSMutableArray array]];
+        }
+        _slots = slots;
+        _pending = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+    }
+    return self;
+}
+
+- (id)scheduleAfter:(NSTimeInterval)timeout handler:(dispatch_block_t)handler {
+    NSUInteger ticks = MAX(1, (NSUInteger)ceil(timeout / SINTimeoutWheelTick));
+    SINTimeout *entry = [[SINTimeout alloc] init];
+    entry.handler = handler;
+    entry.rounds = (ticks - 1) / SINTimeoutWheelSlots;
+    [self.slots[(self.cursor + ticks) % SINTimeoutWheelSlots] addObject:entry];
+    [self.pending addObject:entry];
+    [self start];
+    return entry;
+}
+
+- (void)cancel:(id)token {
+    // the entry stays in its slot and is swept when the wheel reaches it
+    [self.pending removeObject:token];
+    if (self.pending.count == 0) {
+        [self stop];
+    }
+}
+
+- (void)start {
+    if (self.timer) {
+        return;
+    }
+    self.timer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_main_queue());
+    uint64_t interval = (uint64_t)(SINTimeoutWheelTick * NSEC_PER_SEC);
+    dispatch_source_set_timer(self.timer, dispatch_time(DISPATCH_TIME_NOW, interval), interval, interval / 10);
+    __weak SINTimeoutWheel *weakSelf = self;
+    dispatch_source_set_event_handler(self.timer, ^{
+        [weakSelf tick];
+    });
+    dispatch_resume(self.timer);
+}
+
+- (void)stop {
+    if (self.timer) {
+        dispatch_source_cancel(self.timer);
+        self.timer = nil;
+    }
+    for (NSMutableArray *slot in self.slots) {
+        [slot removeAllObjects];
+    }
+}
+
+- (void)tick {
+    self.cursor = (self.cursor + 1) % SINTimeoutWheelSlots;
+    NSMutableArray<SINTimeout *> *slot = self.slots[self.cursor];
+    NSMutableArray<SINTimeout *> *expired = [NSMutableArray array];
+    for (SINTimeout *entry in [slot copy]) {
+        if (![self.pending containsObject:entry]) {
+            [slot removeObject:entry];
+        } else if (entry.rounds > 0) {
+            entry.rounds--;
+        } else {
+            [slot removeObject:entry];
+            [self.pending removeObject:entry];
+            [expired addObject:entry];
+        }
+    }
+    // run after the sweep, handlers may schedule new timeouts
+    for (SINTimeout *entry in expired) {
+        entry.handler();
+    }
+    if (self.pending.count == 0) {
+        [self stop];
+    }
+}
+
+@end
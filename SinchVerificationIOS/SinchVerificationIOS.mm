@@ -0,0 +1,538 @@
+#import "SinchVerificationIOS.h"
+#import "RCTConvert.h"
+#import "RCTInvalidating.h"
+#import "SINTimeoutWheel.h"
+#import <SinchVerification/SinchVerification.h>
+
+#include "SinchVerificationCore.h"
+
+using sinchverification::Core;
+using sinchverification::Prepared;
+using sinchverification::Resume;
+
+// Recorded session files are JSON lines: {"t": ms since recording started, "event": name, "message": optional},
+// sms lines also have "automatic": false, the SDK does not complete the verification by itself here.
+// The event names match the Android bridge so recordings from either platform can be replayed on both.
+static NSString *const SINRecordEventSMS = @"sms";
+static NSString *const SINRecordEventFlashCall = @"flashCall";  // Android recordings only
+static NSString *const SINRecordEventVerify = @"verify";
+static NSString *const SINRecordEventInitiated = @"onInitiated";
+static NSString *const SINRecordEventInitiationFailed = @"onInitiationFailed";
+static NSString *const SINRecordEventVerified = @"onVerified";
+static NSString *const SINRecordEventVerificationFailed = @"onVerificationFailed";
+
+typedef void (^SINCompletionHandler)(BOOL success, NSError *error);
+
+// The session itself lives in the shared core, which persists it so an
+// in-flight verification survives the module being recreated with a new JS
+// context, see resume. Only the SDK objects, the JS callbacks and the deadline
+// are kept here, process wide as well.
+static id<SINVerification> SINSessionVerification;
+static RCTResponseSenderBlock SINResumeCallback;
+static id SINSessionDeadline;
+static RCTResponseSenderBlock SINSessionCallback;
+static int64_t SINSessionId;
+
+// The recording is process wide too, like the session: completion handlers of
+// a module torn down by a reload keep writing to it, and the new JS context
+// can still stop it and get its path.
+static NSFileHandle *SINRecordFile;
+static NSString *SINRecordPath;
+static CFAbsoluteTime SINRecordStart;
+
+// nil safe, -UTF8String of nil is NULL
+static std::string SINString(NSString *string) {
+    return string.UTF8String ?: "";
+}
+
+// The core session event of a recorded callback
+static sinchverification::SessionEvent SINSessionEvent(NSString *event) {
+    if ([event isEqualToString:SINRecordEventInitiated]) {
+        return sinchverification::EventInitiated;
+    } else if ([event isEqualToString:SINRecordEventInitiationFailed]) {
+        return sinchverification::EventInitiationFailed;
+    } else if ([event isEqualToString:SINRecordEventVerified]) {
+        return sinchverification::EventVerified;
+    }
+    return sinchverification::EventVerificationFailed;
+}
+
+// replay sessions, kept apart from the live one: not persisted, no rate limit
+static Core &SINReplayCore() {
+    static Core core;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        core.limiter.setLimit(0, sinchverification::Clock::duration::zero());
+    });
+    return core;
+}
+
+// recordings do not keep the number, the placeholder is taken as is
+static bool SINReplayFormatter(const std::string &raw, const std::string &, std::string &e164) {
+    e164 = raw;
+    return true;
+}
+
+// The SDK's answer to [verification cancel], sent on a timeout or reset. Those
+// already answered the callback and closed the session, so the result is not
+// recorded nor passed to the core.
+static BOOL SINIsCancelled(NSError *error) {
+    return [error.domain isEqualToString:SINVerificationErrorDomain] && error.code == SINVerificationErrorCancelled;
+}
+
+@interface SinchVerificationIOS () <RCTInvalidating>
+
+@property (assign, nonatomic) BOOL invalidated;
+
+
+@end
+
+@implementation SinchVerificationIOS
+
+RCT_EXPORT_MODULE()
+
++ (void)initialize {
+    if (self == [SinchVerificationIOS class]) {
+        NSString *library = NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES).firstObject;
+        Core::shared().setStoragePath(SINString([library stringByAppendingPathComponent:@"sinch-verification-session"]));
+    }
+}
+
+// Completion handlers and the timeout wheel run on the main queue, and
+// SINPhoneNumberUtil is not thread-safe, so keep everything there.
+- (dispatch_queue_t)methodQueue {
+    return dispatch_get_main_queue();
+}
+
+- (id<SINVerification>)verification {
+    return SINSessionVerification;
+}
+
+- (void)setVerification:(id<SINVerification>)verification {
+    SINSessionVerification = verification;
+}
+
+- (void)invalidate {
+    // the JS callbacks die with the bridge, results are kept for resume instead
+    self.invalidated = YES;
+}
+
+RCT_EXPORT_METHOD(resume:(RCTResponseSenderBlock)callback) {
+    Resume resume = Core::shared().resume();
+    NSString *method = @(resume.method.c_str());
+    NSString *phoneNumber = @(resume.phoneNumber.c_str());
+    switch (resume.status) {
+        case sinchverification::ResumePending:
+            if (resume.result.success) {
+                callback(@[[NSNull null]]);
+            } else if (resume.result.code.empty()) {
+                callback(@[@(resume.result.message.c_str())]);
+            } else {
+                callback(@[@{@"code": @(resume.result.code.c_str()), @"message": @(resume.result.message.c_str())}]);
+            }
+            break;
+        case sinchverification::ResumeInFlight:
+            // still in flight, the eventual result goes to this callback
+            SINResumeCallback = callback;
+            break;
+        case sinchverification::ResumeInitiated:
+            // initiated and waiting for the code, verify can be called without a new sms
+            callback(@[[NSNull null], @{@"status": @"initiated", @"method": method, @"phoneNumber": phoneNumber}]);
+            break;
+        case sinchverification::ResumeLost:
+            // the process was killed, the SDK objects of the session are gone
+            callback(@[@{@"code": @"lost",
+                         @"message": @"The verification was interrupted, start a new one",
+                         @"method": method,
+                         @"phoneNumber": phoneNumber}]);
+            break;
+        case sinchverification::ResumeNone:
+            callback(@[@"No verification in progress"]);
+            break;
+    }
+}
+
+RCT_EXPORT_METHOD(sms:(NSString *)applicationKey phoneNumber:(NSString *)phoneNumber custom:(NSString *)custom region:(NSString *)region timeout:(double)timeout callback:(RCTResponseSenderBlock)callback) {
+    [self record:SINRecordEventSMS fields:@{@"automatic": @NO}];
+    // the given region, or the user's current region by carrier info
+    Prepared prepared = Core::shared().prepare("sms", SINString(phoneNumber), SINString(region),
+                                               SINString([SINDeviceRegion currentCountryCode]), false,
+                                               [](const std::string &raw, const std::string &defaultRegion, std::string &e164) {
+        NSError *parseError = nil;
+        id<SINPhoneNumber> number = [SINPhoneNumberUtil() parse:@(raw.c_str())
+                                                  defaultRegion:defaultRegion.empty() ? nil : @(defaultRegion.c_str())
+                                                          error:&parseError];
+        if (!number) {
+            return false;
+        }
+        e164 = SINString([SINPhoneNumberUtil() formatNumber:number format:SINPhoneNumberFormatE164]);
+        return true;
+    });
+    if (prepared.status == sinchverification::PrepareInvalidNumber) {
+        callback(@[@{@"code": @"invalid_number", @"message": @"Invalid phone number"}]);
+        return;
+    }
+    if (prepared.status == sinchverification::PrepareRateLimited) {
+        callback(@[@{@"code": @"rate_limited",
+                     @"message": @"Too many verification attempts for this number, try again later"}]);
+        return;
+    }
+    int64_t sessionId = prepared.sessionId;
+    SINSessionId = sessionId;
+
+    id<SINVerification> verification = [SINVerification SMSVerificationWithApplicationKey:applicationKey
+                                                                              phoneNumber:@(prepared.phoneNumber.c_str())
+                                                                                   custom:custom];
+    self.verification = verification; // retain the verification instance
+    callback = [self callback:callback withDeadline:timeout forVerification:verification];
+    [verification initiateWithCompletionHandler:[self completionHandlerForSession:sessionId
+                                                                             core:Core::shared()
+                                                                           record:YES
+                                                                     successEvent:SINRecordEventInitiated
+                                                                     failureEvent:SINRecordEventInitiationFailed
+                                                                         callback:callback]];
+}
+
+RCT_EXPORT_METHOD(flashCall:(NSString *)applicationKey phoneNumber:(NSString *)phoneNumber custom:(NSString *)custom region:(NSString *)region timeout:(double)timeout callback:(RCTResponseSenderBlock)callback) {
+    // The iOS SDK only does sms verification
+    callback(@[@{@"code": @"unsupported", @"message": @"flashCall() is not supported on iOS"}]);
+}
+
+RCT_EXPORT_METHOD(verify:(NSString *)code timeout:(double)timeout callback:(RCTResponseSenderBlock)callback) {
+  [self record:SINRecordEventVerify message:nil];
+  id<SINVerification> verification = self.verification;
+  if (!verification) {
+    callback(@[@"Verification object not found. Did you call sms() first?"]);
+    return;
+  }
+  int64_t sessionId = SINSessionId;
+  Core::shared().handle(sessionId, sinchverification::EventVerifying);
+  callback = [self callback:callback withDeadline:timeout forVerification:verification];
+  [verification verifyCode:code
+         completionHandler:[self completionHandlerForSession:sessionId
+                                                        core:Core::shared()
+                                                      record:YES
+                                                successEvent:SINRecordEventVerified
+                                                failureEvent:SINRecordEventVerificationFailed
+                                                    callback:callback]];
+}
+
+RCT_EXPORT_METHOD(reset:(RCTResponseSenderBlock)callback) {
+    id<SINVerification> verification = self.verification;
+    self.verification = nil;
+    if (SINSessionDeadline) {
+        [[SINTimeoutWheel sharedWheel] cancel:SINSessionDeadline];
+        SINSessionDeadline = nil;
+    }
+    if (SINSessionCallback) {
+        SINSessionCallback(@[@{@"code": @"cancelled", @"message": @"Verification was reset"}]);
+        SINSessionCallback = nil;
+    }
+    SINResumeCallback = nil;
+    Core::shared().reset();
+    // the completion handler then receives SINVerificationErrorCancelled, which it ignores
+    [verification cancel];
+    callback(@[[NSNull null], [NSNull null]]);
+}
+
+RCT_EXPORT_METHOD(setRateLimit:(NSInteger)maxAttempts windowMs:(double)windowMs callback:(RCTResponseSenderBlock)callback) {
+    Core::shared().limiter.setLimit(MAX(maxAttempts, 0),
+                                    std::chrono::duration_cast<sinchverification::Clock::duration>(std::chrono::duration<double, std::milli>(windowMs)));
+    callback(@[[NSNull null], [NSNull null]]);
+}
+
+RCT_EXPORT_METHOD(metrics:(RCTResponseSenderBlock)callback) {
+    sinchverification::Metrics metrics = Core::shared().metrics();
+    callback(@[[NSNull null], @{@"initiations": @(metrics.initiations),
+                                @"verified": @(metrics.verified),
+                                @"failed": @(metrics.failed),
+                                @"timedOut": @(metrics.timedOut),
+                                @"cancelled": @(metrics.cancelled),
+                                @"rateLimited": @(metrics.rateLimited),
+                                @"cacheHits": @(metrics.cacheHits),
+                                @"cacheMisses": @(metrics.cacheMisses),
+                                @"meanLatencyMs": @(metrics.meanLatencyMs),
+                                @"maxLatencyMs": @(metrics.maxLatencyMs)}]);
+}
+
+RCT_EXPORT_METHOD(exampleNumbers:(RCTResponseSenderBlock)callback) {
+    // Example numbers never change at runtime, so the table is built once per
+    // process on a background queue, with a private SINPhoneNumberUtil since the
+    // shared one is not thread-safe.
+    static NSDictionary *table;
+    static dispatch_queue_t queue;
+    static dispatch_once_t once;
+    dispatch_once(&once, ^{
+        queue = dispatch_queue_create("com.kevinresol.sinchverification.examplenumbers", DISPATCH_QUEUE_SERIAL);
+    });
+    dispatch_async(queue, ^{
+        if (!table) {
+            id<SINPhoneNumberUtil> util = SINPhoneNumberUtilCreate();
+            NSMutableDictionary *examples = [NSMutableDictionary dictionary];
+            for (id<SINRegionInfo> region in [util regionListWithLocale:[NSLocale currentLocale]].entries) {
+                id<SINPhoneNumber> example = [util exampleNumberForRegion:region.isoCountryCode];
+                if (!example) {
+                    continue;
+                }
+                examples[region.isoCountryCode] = @{@"e164": [util formatNumber:example format:SINPhoneNumberFormatE164],
+                                                    @"international": [util formatNumber:example format:SINPhoneNumberFormatInternational],
+                                                    @"national": [util formatNumber:example format:SINPhoneNumberFormatNational]};
+            }
+            table = [examples copy];
+        }
+        NSDictionary *result = table;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            callback(@[[NSNull null], result]);
+        });
+    });
+}
+
+RCT_EXPORT_METHOD(record:(BOOL)enabled callback:(RCTResponseSenderBlock)callback) {
+    [SINRecordFile closeFile];
+    NSString *path = SINRecordPath;
+    SINRecordFile = nil;
+    SINRecordPath = nil;
+    if (enabled) {
+        NSString *name = [NSString stringWithFormat:@"sinch-verification-%lld.jsonl", (long long)([[NSDate date] timeIntervalSince1970] * 1000)];
+        path = [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+        if (![[NSFileManager defaultManager] createFileAtPath:path contents:nil attributes:nil]) {
+            callback(@[@"Unable to create recording file"]);
+            return;
+        }
+        SINRecordFile = [NSFileHandle fileHandleForWritingAtPath:path];
+        SINRecordPath = path;
+        SINRecordStart = CFAbsoluteTimeGetCurrent();
+    }
+    callback(@[[NSNull null], path ?: [NSNull null]]);
+}
+
+RCT_EXPORT_METHOD(replay:(NSString *)path speed:(double)speed callback:(RCTResponseSenderBlock)callback) {
+    if (SINSessionCallback || Core::shared().sessions.current().awaiting()) {
+        callback(@[@"A verification is in progress, cannot replay now"]);
+        return;
+    }
+    NSString *contents = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:nil];
+    if (!contents) {
+        callback(@[[NSString stringWithFormat:@"Unable to read %@", path]]);
+        return;
+    }
+
+    NSMutableArray *events = [NSMutableArray array];
+    NSUInteger callbacks = 0;
+    double recordedMs = 0;
+    for (NSString *line in [contents componentsSeparatedByString:@"\n"]) {
+        NSData *data = [line dataUsingEncoding:NSUTF8StringEncoding];
+        NSDictionary *event = line.length ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+        if ([event isKindOfClass:[NSDictionary class]] && [event[@"event"] isKindOfClass:[NSString class]]) {
+            [events addObject:event];
+            if ([event[@"event"] hasPrefix:@"on"]) {
+                callbacks++;
+                recordedMs = [event[@"t"] doubleValue];
+            }
+        }
+    }
+    if (callbacks == 0) {
+        callback(@[[NSString stringWithFormat:@"No callbacks found in %@", path]]);
+        return;
+    }
+
+    // Feed the recording on the main queue like the SDK does, at the original
+    // pace divided by speed. The callbacks go through the same completion
+    // handlers as a live session, driving a replay-only session in the core,
+    // with the accepted results counted instead of going to a JS callback.
+    // Nothing is recorded.
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    __block int64_t sessionId = 0;
+    __block NSUInteger remaining = callbacks;
+    __block NSUInteger verified = 0;
+    __block NSUInteger failed = 0;
+    __block double maxLagMs = 0;
+
+    for (NSDictionary *event in events) {
+        NSString *name = event[@"event"];
+        double dueMs = speed > 0 ? [event[@"t"] doubleValue] / speed : 0;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(dueMs * NSEC_PER_MSEC)), dispatch_get_main_queue(), ^{
+            if ([name isEqualToString:SINRecordEventSMS] || [name isEqualToString:SINRecordEventFlashCall]) {
+                // recordings without the flag are taken as automatic for a flash call only, like the host replay
+                BOOL automatic = event[@"automatic"] ? [event[@"automatic"] boolValue] : [name isEqualToString:SINRecordEventFlashCall];
+                sessionId = SINReplayCore().prepare(SINString(name), "+0", "", "", automatic, SINReplayFormatter).sessionId;
+                return;
+            }
+            if ([name isEqualToString:SINRecordEventVerify]) {
+                SINReplayCore().handle(sessionId, sinchverification::EventVerifying);
+                return;
+            }
+            if (![name hasPrefix:@"on"]) {
+                return;
+            }
+            maxLagMs = MAX(maxLagMs, (CFAbsoluteTimeGetCurrent() - start) * 1000 - dueMs);
+            if (!sessionId) {
+                // the recording was started after sms
+                sessionId = SINReplayCore().prepare("sms", "+0", "", "", false, SINReplayFormatter).sessionId;
+            }
+
+            BOOL initiation = [name isEqualToString:SINRecordEventInitiated] || [name isEqualToString:SINRecordEventInitiationFailed];
+            BOOL success = [name isEqualToString:SINRecordEventInitiated] || [name isEqualToString:SINRecordEventVerified];
+            NSError *error = success ? nil : [NSError errorWithDomain:SINVerificationErrorDomain
+                                                                 code:0
+                                                             userInfo:@{NSLocalizedDescriptionKey: event[@"message"] ?: @""}];
+            SINCompletionHandler handler = [self completionHandlerForSession:sessionId
+                                                                        core:SINReplayCore()
+                                                                      record:NO
+                                                                successEvent:initiation ? SINRecordEventInitiated : SINRecordEventVerified
+                                                                failureEvent:initiation ? SINRecordEventInitiationFailed : SINRecordEventVerificationFailed
+                                                                    callback:^(NSArray *response) {
+                if (response.firstObject != [NSNull null]) {
+                    failed++;
+                } else if (!initiation) {
+                    verified++;
+                }
+            }];
+            handler(success, error);
+
+            if (--remaining == 0) {
+                callback(@[[NSNull null], @{@"events": @(callbacks),
+                                            @"verified": @(verified),
+                                            @"failed": @(failed),
+                                            @"recordedMs": @(recordedMs),
+                                            @"elapsedMs": @((CFAbsoluteTimeGetCurrent() - start) * 1000),
+                                            @"maxLagMs": @(maxLagMs)}]);
+            }
+        });
+    }
+}
+
+/**
+ * Wraps callback so it is invoked at most once, and arms a deadline (in ms, 0
+ * for none) on the shared timeout wheel. The callback fires when the SDK request
+ * completes, so the deadline covers initiation for sms and the code check for
+ * verify, matching Android. On expiry the verification is
+ * cancelled and the callback receives a {code: "timeout"} error.
+ */
+- (RCTResponseSenderBlock)callback:(RCTResponseSenderBlock)callback
+                      withDeadline:(double)timeout
+                   forVerification:(id<SINVerification>)verification {
+    __block BOOL done = NO;
+    __block id deadline = nil;
+    __block __weak RCTResponseSenderBlock weakOnce = nil;
+    RCTResponseSenderBlock once = ^(NSArray *response) {
+        if (done) {
+            return;
+        }
+        done = YES;
+        if (SINSessionCallback == weakOnce) {
+            SINSessionCallback = nil;
+        }
+        if (deadline) {
+            [[SINTimeoutWheel sharedWheel] cancel:deadline];
+            if (SINSessionDeadline == deadline) {
+                SINSessionDeadline = nil;
+            }
+            deadline = nil;
+        }
+        [self send:response callback:callback];
+    };
+    if (timeout > 0) {
+        deadline = [[SINTimeoutWheel sharedWheel] scheduleAfter:timeout / 1000 handler:^{
+            if (SINSessionDeadline == deadline) {
+                SINSessionDeadline = nil;
+            }
+            deadline = nil;
+            once(@[@{@"code": @"timeout",
+                     @"message": [NSString stringWithFormat:@"Verification timed out after %.0fms", timeout]}]);
+            // close the session first, the SDK may call the completion handler from within cancel
+            if (SINSessionVerification == verification) {
+                Core::shared().handle(SINSessionId, sinchverification::EventTimedOut);
+                SINSessionVerification = nil;
+            }
+            // invokes the completion handler with SINVerificationErrorCancelled, which it ignores
+            [verification cancel];
+        }];
+        SINSessionDeadline = deadline;
+    }
+    weakOnce = once;
+    SINSessionCallback = once;
+    return once;
+}
+
+/**
+ * Delivers a result to the JS callback of the call, or, if the bridge has
+ * been torn down since, to a callback registered with resume. With neither
+ * around the result is persisted until resume is called.
+ */
+- (void)send:(NSArray *)response callback:(RCTResponseSenderBlock)callback {
+    RCTResponseSenderBlock resumed = SINResumeCallback;
+    SINResumeCallback = nil;
+    if (resumed) {
+        resumed(response);
+    }
+    if (!self.invalidated) {
+        callback(response);
+    } else if (!resumed) {
+        id error = response.firstObject;
+        sinchverification::Result result;
+        result.success = error == [NSNull null];
+        if ([error isKindOfClass:[NSDictionary class]]) {
+            result.code = SINString(error[@"code"]);
+            result.message = SINString(error[@"message"]);
+        } else if ([error isKindOfClass:[NSString class]]) {
+            result.message = SINString(error);
+        }
+        Core::shared().savePending(result);
+    }
+}
+
+/**
+ * The completion handler of an SDK request: drives the session in core with
+ * the result, recorded for a live session, and hands the response to callback
+ * if the session accepts it. Replay passes its own core and callback.
+ */
+- (SINCompletionHandler)completionHandlerForSession:(int64_t)sessionId
+                                               core:(Core &)core
+                                             record:(BOOL)record
+                                       successEvent:(NSString *)successEvent
+                                       failureEvent:(NSString *)failureEvent
+                                           callback:(RCTResponseSenderBlock)callback {
+    Core *sessionCore = &core;
+    return ^(BOOL success, NSError *error) {
+        if (!success && SINIsCancelled(error)) {
+            return;
+        }
+        NSString *event = success ? successEvent : failureEvent;
+        if (record) {
+            [self record:event message:success ? nil : error.description];
+        }
+        if (sessionCore->handle(sessionId, SINSessionEvent(event))) {
+            callback([SinchVerificationIOS responseWithSuccess:success error:error]);
+        }
+    };
+}
+
++ (NSArray *)responseWithSuccess:(BOOL)success error:(NSError *)error {
+    return success ? @[[NSNull null]] : @[error.description];
+}
+
+- (void)record:(NSString *)event message:(NSString *)message {
+    [self record:event fields:message ? @{@"message": message} : nil];
+}
+
+- (void)record:(NSString *)event fields:(NSDictionary *)fields {
+    if (!SINRecordFile) {
+        return;
+    }
+    NSMutableDictionary *line = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                 @((long long)((CFAbsoluteTimeGetCurrent() - SINRecordStart) * 1000)), @"t",
+                                 event, @"event", nil];
+    [line addEntriesFromDictionary:fields];
+    NSMutableData *data = [[NSJSONSerialization dataWithJSONObject:line options:0 error:nil] mutableCopy];
+    [data appendData:[@"\n" dataUsingEncoding:NSUTF8StringEncoding]];
+    // recording is best effort, never let it break a live verification
+    @try {
+        [SINRecordFile writeData:data];
+    } @catch (NSException *exception) {
+        [SINRecordFile closeFile];
+        SINRecordFile = nil;
+    }
+}
+
+@end
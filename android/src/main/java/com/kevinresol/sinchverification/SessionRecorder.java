@@ -0,0 +1,129 @@
+package com.kevinresol.sinchverification;
+
+import android.os.SystemClock;
+
+import org.json.JSONException;
+import org.json.JSONObject;
+
+import java.io.BufferedReader;
+import java.io.File;
+import java.io.FileReader;
+import java.io.FileWriter;
+import java.io.IOException;
+import java.io.Writer;
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * Records the sequence and timing of verification calls and SDK listener
+ * callbacks as JSON lines, so a session can later be replayed against the
+ * bridge without talking to the Sinch backend.
+ *
+ * Each line is an object: {"t": ms since recording started, "event": name, "message": optional},
+ * sms and flashCall lines also have "automatic": whether the SDK completes the verification by itself
+ */
+class SessionRecorder {
+
+    static final String EVENT_SMS = "sms";
+    static final String EVENT_FLASH_CALL = "flashCall";
+    static final String EVENT_VERIFY = "verify";
+    static final String EVENT_INITIATED = "onInitiated";
+    static final String EVENT_INITIATION_FAILED = "onInitiationFailed";
+    static final String EVENT_VERIFIED = "onVerified";
+    static final String EVENT_VERIFICATION_FAILED = "onVerificationFailed";
+
+    static class Event {
+        final long time;
+        final String name;
+        final String message;
+        final boolean automatic;
+
+        Event(long time, String name, String message, boolean automatic) {
+            this.time = time;
+            this.name = name;
+            this.message = message;
+            this.automatic = automatic;
+        }
+
+        boolean isCallback() {
+            return name.startsWith("on");
+        }
+    }
+
+    private final File mFile;
+    private final long mStart;
+    private Writer mWriter;
+
+    SessionRecorder(File file) throws IOException {
+        mFile = file;
+        mStart = SystemClock.elapsedRealtime();
+        mWriter = new FileWriter(file, false);
+    }
+
+    String getPath() {
+        return mFile.getAbsolutePath();
+    }
+
+    void record(String name, String message) {
+        write(name, message, null);
+    }
+
+    // sms() / flashCall(), which start a session
+    void recordStart(String name, boolean automatic) {
+        write(name, null, automatic);
+    }
+
+    private synchronized void write(String name, String message, Boolean automatic) {
+        if (mWriter == null) {
+            return;
+        }
+        try {
+            JSONObject line = new JSONObject();
+            line.put("t", SystemClock.elapsedRealtime() - mStart);
+            line.put("event", name);
+            if (message != null) {
+                line.put("message", message);
+            }
+            if (automatic != null) {
+                line.put("automatic", automatic.booleanValue());
+            }
+            mWriter.write(line.toString());
+            mWriter.write('\n');
+            mWriter.flush();
+        } catch (JSONException | IOException e) {
+            // Recording is best effort, never let it break a live verification
+        }
+    }
+
+    synchronized void close() {
+        if (mWriter != null) {
+            try {
+                mWriter.close();
+            } catch (IOException e) {
+                // ignore
+            }
+            mWriter = null;
+        }
+    }
+
+    static List<Event> load(String path) throws IOException, JSONException {
+        List<Event> events = new ArrayList<>();
+        BufferedReader reader = new BufferedReader(new FileReader(path));
+        try {
+            String line;
+            while ((line = reader.readLine()) != null) {
+                if (line.trim().isEmpty()) {
+                    continue;
+                }
+                JSONObject object = new JSONObject(line);
+                String name = object.getString("event");
+                // older recordings do not have the flag, like the host replay take only a flash call as automatic
+                boolean automatic = object.optBoolean("automatic", EVENT_FLASH_CALL.equals(name));
+                events.add(new Event(object.getLong("t"), name, object.optString("message", null), automatic));
+            }
+        } finally {
+            reader.close();
+        }
+        return events;
+    }
+}
@@ -0,0 +1,122 @@
+package com.kevinresol.sinchverification;
+
+import com.facebook.react.bridge.Arguments;
+import com.facebook.react.bridge.WritableMap;
+
+import com.sinch.verification.PhoneNumberUtils;
+
+/**
+ * Java side of the shared C++ core in cpp/core, which owns the verification
+ * session (state machine, persistence, resume), number normalization cache,
+ * metrics and rate limiting for both platforms.
+ */
+class SinchVerificationCore {
+
+    static {
+        System.loadLibrary("sinchverificationcore");
+    }
+
+    // mirrors sinchverification::SessionEvent
+    static final int EVENT_INITIATED = 0;
+    static final int EVENT_INITIATION_FAILED = 1;
+    static final int EVENT_VERIFYING = 2;
+    static final int EVENT_VERIFIED = 3;
+    static final int EVENT_VERIFICATION_FAILED = 4;
+    static final int EVENT_TIMED_OUT = 5;
+    static final int EVENT_CANCELLED = 6;
+
+    static final String PREPARE_OK = "ok";
+    static final String PREPARE_INVALID_NUMBER = "invalid_number";
+    static final String PREPARE_RATE_LIMITED = "rate_limited";
+
+    static final String RESUME_NONE = "none";
+    static final String RESUME_PENDING = "pending";
+    static final String RESUME_IN_FLIGHT = "in_flight";
+    static final String RESUME_INITIATED = "initiated";
+    static final String RESUME_LOST = "lost";
+
+    private static final String[] METRICS = {
+        "initiations", "verified", "failed", "timedOut", "cancelled", "rateLimited",
+        "cacheHits", "cacheMisses", "meanLatencyMs", "maxLatencyMs",
+    };
+
+    static class Prepared {
+        String status;
+        long sessionId;
+        String phoneNumber;
+    }
+
+    static class Resume {
+        String status;
+        boolean success;
+        String code;
+        String message;
+        String method;
+        String phoneNumber;
+    }
+
+    // where the session is persisted, loads the session left by a previous process
+    static native void setStoragePath(String path);
+
+    // at most maxAttempts initiations per number within windowMs, 0 disables the limit
+    static native void setRateLimit(int maxAttempts, double windowMs);
+
+    // returns false if the event is not valid for the session, e.g. it was reset
+    static native boolean handle(long sessionId, int event);
+
+    // cancels the session and drops any pending result
+    static native void reset();
+
+    // replay() drives sessions of its own, apart from the live one and without rate limit
+    static native long beginReplay(String method, boolean automatic);
+
+    static native boolean handleReplay(long sessionId, int event);
+
+    static native void savePending(boolean success, String code, String message);
+
+    private static native String[] nativePrepare(String method, String phoneNumber, String preferredRegion,
+                                                 String deviceRegion, boolean automatic);
+
+    private static native String[] nativeResume();
+
+    private static native double[] metrics();
+
+    // called back by nativePrepare on a cache miss, returns null if the number is invalid
+    private static String formatNumberToE164(String phoneNumber, String region) {
+        return PhoneNumberUtils.formatNumberToE164(phoneNumber, region);
+    }
+
+    /**
+     * Normalizes the number, applies the rate limit and starts a session.
+     * preferredRegion may be null, deviceRegion is used then.
+     */
+    static Prepared prepare(String method, String phoneNumber, String preferredRegion, String deviceRegion, boolean automatic) {
+        String[] values = nativePrepare(method, phoneNumber, preferredRegion, deviceRegion, automatic);
+        Prepared prepared = new Prepared();
+        prepared.status = values[0];
+        prepared.sessionId = Long.parseLong(values[1]);
+        prepared.phoneNumber = values[2];
+        return prepared;
+    }
+
+    static Resume resume() {
+        String[] values = nativeResume();
+        Resume resume = new Resume();
+        resume.status = values[0];
+        resume.success = "1".equals(values[1]);
+        resume.code = values[2].isEmpty() ? null : values[2];
+        resume.message = values[3].isEmpty() ? null : values[3];
+        resume.method = values[4];
+        resume.phoneNumber = values[5];
+        return resume;
+    }
+
+    static WritableMap metricsMap() {
+        double[] values = metrics();
+        WritableMap map = Arguments.createMap();
+        for (int i = 0; i < METRICS.length; i++) {
+            map.putDouble(METRICS[i], values[i]);
+        }
+        return map;
+    }
+}
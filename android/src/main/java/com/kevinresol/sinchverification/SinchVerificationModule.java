@@ -1,10 +1,15 @@
 package com.kevinresol.sinchverification;
 
+import android.os.Handler;
+import android.os.Looper;
+import android.os.SystemClock;
+
 import com.facebook.react.modules.network.ForwardingCookieHandler;
 import com.facebook.react.bridge.ReactApplicationContext;
 import com.facebook.react.bridge.ReactContextBaseJavaModule;
 import com.facebook.react.bridge.ReactMethod;
 import com.facebook.react.bridge.ReadableMap;
+import com.facebook.react.bridge.UiThreadUtil;
 import com.facebook.react.bridge.Callback;
 import com.facebook.react.bridge.Arguments;
 import com.facebook.react.bridge.WritableMap;
@@ -19,6 +24,9 @@ import com.sinch.verification.Verification;
 import com.sinch.verification.VerificationListener;
 import com.sinch.verification.PhoneNumberUtils;
 
+import org.json.JSONException;
+
+import java.io.File;
 import java.io.IOException;
 import java.net.URISyntaxException;
 import java.net.URI;
@@ -30,86 +38,529 @@ import java.util.Map;
 
 public class SinchVerificationModule extends ReactContextBaseJavaModule {
 
+    // The session itself lives in the shared core, which persists it so an
+    // in-flight verification survives the module being recreated with a new
+    // JS context, see resume(). Only the SDK objects, the JS callback and the
+    // deadline are kept here, process wide as well. They are only touched on
+    // the main thread, where the timeout wheel runs and listener callbacks are
+    // forwarded to, so react methods hop there first.
+    private static Verification sVerification;
+    private static Callback sCallback;
+    private static MyVerificationListener sListener;
+    private static TimeoutWheel.Timeout sTimeout;
+    // written from any thread, SessionRecorder itself is synchronized
+    private static volatile SessionRecorder sRecorder;
+    private static boolean sStorageReady;
+
     private ReactApplicationContext mContext;
-    private Verification mVerification;
-    private Callback mCallback;
 	
     public SinchVerificationModule(ReactApplicationContext context) {
         super(context);
         mContext = context;
+        if (!sStorageReady) {
+            File file = new File(context.getApplicationContext().getFilesDir(), "sinch-verification-session");
+            SinchVerificationCore.setStoragePath(file.getPath());
+            sStorageReady = true;
+        }
     }
 
     public String getName() {
         return "SinchVerificationAndroid";
     }
 
+    @Override
+    public void onCatalystInstanceDestroy() {
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                // the JS callback dies with its context, results are kept for resume() instead
+                sCallback = null;
+            }
+        });
+    }
+
+    @ReactMethod
+    public void resume(final Callback callback) {
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                SinchVerificationCore.Resume resume = SinchVerificationCore.resume();
+                if (SinchVerificationCore.RESUME_PENDING.equals(resume.status)) {
+                    if (resume.success) {
+                        callback.invoke(null, null);
+                    } else {
+                        WritableMap map = Arguments.createMap();
+                        map.putString("message", resume.message);
+                        if (resume.code != null) {
+                            map.putString("code", resume.code);
+                        }
+                        callback.invoke(map, null);
+                    }
+                } else if (SinchVerificationCore.RESUME_IN_FLIGHT.equals(resume.status)) {
+                    // still in flight, the eventual result goes to this callback
+                    sCallback = callback;
+                } else if (SinchVerificationCore.RESUME_INITIATED.equals(resume.status)) {
+                    // initiated and waiting for the code, verify() can be called without a new sms
+                    WritableMap map = Arguments.createMap();
+                    map.putString("status", "initiated");
+                    map.putString("method", resume.method);
+                    map.putString("phoneNumber", resume.phoneNumber);
+                    callback.invoke(null, map);
+                } else if (SinchVerificationCore.RESUME_LOST.equals(resume.status)) {
+                    // the process was killed, the SDK objects of the session are gone
+                    WritableMap map = Arguments.createMap();
+                    map.putString("code", "lost");
+                    map.putString("message", "The verification was interrupted, start a new one");
+                    map.putString("method", resume.method);
+                    map.putString("phoneNumber", resume.phoneNumber);
+                    callback.invoke(map, null);
+                } else {
+                    callback.invoke("No verification in progress", null);
+                }
+            }
+        });
+    }
+
+    @ReactMethod
+    public void reset(final Callback callback) {
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                if (sListener != null) {
+                    sListener.cancel();
+                    sListener = null;
+                }
+                WritableMap map = Arguments.createMap();
+                map.putString("code", "cancelled");
+                map.putString("message", "Verification was reset");
+                consumeCallback(false, map);
+                cancelDeadline();
+                sVerification = null;
+                SinchVerificationCore.reset();
+                callback.invoke(null, null);
+            }
+        });
+    }
+
     @ReactMethod
-    public void reset(Callback callback) {
-        mVerification = null;
+    public void setRateLimit(int maxAttempts, double windowMs, Callback callback) {
+        SinchVerificationCore.setRateLimit(maxAttempts, windowMs);
         callback.invoke(null, null);
     }
 
     @ReactMethod
-    public void flashCall(String applicationKey, String phoneNumber, String custom, Callback callback) {
-        mCallback = callback;
-        Config config = SinchVerification.config().applicationKey(applicationKey).context(mContext).build();
-        VerificationListener listener = new MyVerificationListener();
-        String defaultRegion = PhoneNumberUtils.getDefaultCountryIso(mContext);
-        String phoneNumberInE164 = PhoneNumberUtils.formatNumberToE164(phoneNumber, defaultRegion);
-        mVerification = SinchVerification.createFlashCallVerification(config, phoneNumberInE164, custom, listener);
-        mVerification.initiate();
+    public void metrics(Callback callback) {
+        callback.invoke(null, SinchVerificationCore.metricsMap());
+    }
+
+    @ReactMethod
+    public void exampleNumbers(Callback callback) {
+        // The Android SDK does not expose example numbers
+        WritableMap map = Arguments.createMap();
+        map.putString("code", "unsupported");
+        map.putString("message", "exampleNumbers() is not supported on Android");
+        callback.invoke(map, null);
     }
 
     @ReactMethod
-    public void sms(String applicationKey, String phoneNumber, String custom, final Callback callback) {
-        mCallback = callback;
-        Config config = SinchVerification.config().applicationKey(applicationKey).context(mContext).build();
-        VerificationListener listener = new MyVerificationListener();
-        String defaultRegion = PhoneNumberUtils.getDefaultCountryIso(mContext);
-        String phoneNumberInE164 = PhoneNumberUtils.formatNumberToE164(phoneNumber, defaultRegion);
-        mVerification = SinchVerification.createSmsVerification(config, phoneNumberInE164, custom, listener);
-        mVerification.initiate();
+    public void record(Boolean enabled, Callback callback) {
+        if (sRecorder != null) {
+            sRecorder.close();
+        }
+        String path = sRecorder != null ? sRecorder.getPath() : null;
+        sRecorder = null;
+        if (enabled) {
+            File file = new File(mContext.getCacheDir(), "sinch-verification-" + System.currentTimeMillis() + ".jsonl");
+            try {
+                sRecorder = new SessionRecorder(file);
+                path = sRecorder.getPath();
+            } catch (IOException e) {
+                callback.invoke(e.getMessage(), null);
+                return;
+            }
+        }
+        callback.invoke(null, path);
     }
 
     @ReactMethod
-    public void verify(String code, final Callback callback) {
-        if (mVerification == null) {
-            callback.invoke("Verification object not found. Did you call flashCall() or sms() first?", null);
+    public void replay(final String path, final double speed, final Callback callback) {
+        final List<SessionRecorder.Event> events;
+        try {
+            events = SessionRecorder.load(path);
+        } catch (IOException | JSONException e) {
+            callback.invoke(e.getMessage(), null);
             return;
         }
-        mCallback = callback;
-        mVerification.verify(code);
+        long recordedMs = 0;
+        int callbacks = 0;
+        for (SessionRecorder.Event event : events) {
+            if (event.isCallback()) {
+                callbacks++;
+                recordedMs = event.time;
+            }
+        }
+        if (callbacks == 0) {
+            callback.invoke("No callbacks found in " + path, null);
+            return;
+        }
+        final long recordedDuration = recordedMs;
+        final int callbackCount = callbacks;
+        final int[] remaining = {callbacks};
+
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                if (sCallback != null) {
+                    callback.invoke("A verification is in progress, cannot replay now", null);
+                    return;
+                }
+                // Feed the recording on the main looper like the SDK does, at the
+                // original pace divided by speed. The callbacks go through the same
+                // listener as a live verification, driving a replay-only session in
+                // the core, with results going to the replay's own sink instead of
+                // the live callback. Nothing is recorded.
+                final Handler handler = new Handler(Looper.getMainLooper());
+                final ReplaySink sink = new ReplaySink();
+                final MyVerificationListener[] listener = {null};
+                final long start = SystemClock.elapsedRealtime();
+                final long[] maxLag = {0};
+                for (final SessionRecorder.Event event : events) {
+                    final long due = speed > 0 ? (long) (event.time / speed) : 0;
+                    handler.postDelayed(new Runnable() {
+                        public void run() {
+                            if (event.isCallback()) {
+                                maxLag[0] = Math.max(maxLag[0], SystemClock.elapsedRealtime() - start - due);
+                            }
+                            dispatch(listener, event, sink);
+                            if (event.isCallback() && --remaining[0] == 0) {
+                                WritableMap result = Arguments.createMap();
+                                result.putInt("events", callbackCount);
+                                result.putInt("verified", sink.verified);
+                                result.putInt("failed", sink.failed);
+                                result.putDouble("recordedMs", recordedDuration);
+                                result.putDouble("elapsedMs", SystemClock.elapsedRealtime() - start);
+                                result.putDouble("maxLagMs", maxLag[0]);
+                                callback.invoke(null, result);
+                            }
+                        }
+                    }, due);
+                }
+            }
+        });
     }
 
-    private void consumeCallback(Boolean success, WritableMap payload) {
-        if (mCallback != null) {
+    /**
+     * Replays one recorded event: sms() / flashCall() start a replay session
+     * with a listener of its own, verify() moves it on, SDK callbacks go to the
+     * listener of the current replay session.
+     */
+    private static void dispatch(MyVerificationListener[] current, SessionRecorder.Event event, ResultSink sink) {
+        boolean starts = SessionRecorder.EVENT_SMS.equals(event.name) || SessionRecorder.EVENT_FLASH_CALL.equals(event.name);
+        if (starts || (current[0] == null && event.isCallback())) {
+            if (current[0] != null) {
+                current[0].cancel();
+            }
+            // a recording started after sms() / flashCall() gets a session for its callbacks, automatic like every one here
+            String method = starts ? event.name : SessionRecorder.EVENT_SMS;
+            boolean automatic = starts ? event.automatic : true;
+            current[0] = new MyVerificationListener(SinchVerificationCore.beginReplay(method, automatic), true, sink);
+            return;
+        }
+        MyVerificationListener listener = current[0];
+        if (listener == null) {
+            return;
+        }
+        Exception e = new Exception(event.message);
+        if (SessionRecorder.EVENT_VERIFY.equals(event.name)) {
+            listener.handle(SinchVerificationCore.EVENT_VERIFYING);
+        } else if (SessionRecorder.EVENT_INITIATED.equals(event.name)) {
+            listener.onInitiated();
+        } else if (SessionRecorder.EVENT_INITIATION_FAILED.equals(event.name)) {
+            listener.onInitiationFailed(e);
+        } else if (SessionRecorder.EVENT_VERIFIED.equals(event.name)) {
+            listener.onVerified();
+        } else if (SessionRecorder.EVENT_VERIFICATION_FAILED.equals(event.name)) {
+            listener.onVerificationFailed(e);
+        }
+    }
+
+    private static WritableMap failurePayload(Exception e) {
+        WritableMap map = Arguments.createMap();
+        map.putString("message", e.getMessage());
+        return map;
+    }
+
+    // where a listener delivers its results: the JS callback of the live session, or a replay
+    private interface ResultSink {
+        void deliver(boolean success, WritableMap payload);
+    }
+
+    private static final ResultSink LIVE = new ResultSink() {
+        public void deliver(boolean success, WritableMap payload) {
+            consumeCallback(success, payload);
+        }
+    };
+
+    private static class ReplaySink implements ResultSink {
+
+        int verified;
+        int failed;
+
+        public void deliver(boolean success, WritableMap payload) {
             if (success) {
-                mCallback.invoke(null, payload);
+                verified++;
             } else {
-                mCallback.invoke(payload, null);
+                failed++;
             }
-            mCallback = null;
         }
     }
 
-    private class MyVerificationListener implements VerificationListener{
+    private static void record(String event, String message) {
+        SessionRecorder recorder = sRecorder;
+        if (recorder != null) {
+            recorder.record(event, message);
+        }
+    }
 
-        public void onInitiated() {
+    private static void recordStart(String method, boolean automatic) {
+        SessionRecorder recorder = sRecorder;
+        if (recorder != null) {
+            recorder.recordStart(method, automatic);
+        }
+    }
 
+    @ReactMethod
+    public void flashCall(String applicationKey, String phoneNumber, String custom, String region, double timeout, Callback callback) {
+        start(SessionRecorder.EVENT_FLASH_CALL, applicationKey, phoneNumber, custom, region, timeout, callback);
+    }
+
+    @ReactMethod
+    public void sms(String applicationKey, String phoneNumber, String custom, String region, double timeout, Callback callback) {
+        start(SessionRecorder.EVENT_SMS, applicationKey, phoneNumber, custom, region, timeout, callback);
+    }
+
+    private void start(final String method, String applicationKey, String phoneNumber, final String custom, String region,
+                       final double timeout, final Callback callback) {
+        recordStart(method, true);
+        final SinchVerificationCore.Prepared prepared = prepare(method, phoneNumber, region, callback);
+        if (prepared == null) {
+            return;
         }
+        final Config config = SinchVerification.config().applicationKey(applicationKey).context(mContext.getApplicationContext()).build();
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                if (sListener != null) {
+                    // late callbacks of the replaced verification must not complete the new one
+                    sListener.cancel();
+                }
+                sCallback = callback;
+                sListener = new MyVerificationListener(prepared.sessionId, false, LIVE);
+                if (SessionRecorder.EVENT_FLASH_CALL.equals(method)) {
+                    sVerification = SinchVerification.createFlashCallVerification(config, prepared.phoneNumber, custom, sListener);
+                } else {
+                    sVerification = SinchVerification.createSmsVerification(config, prepared.phoneNumber, custom, sListener);
+                }
+                startDeadline(timeout);
+                sVerification.initiate();
+            }
+        });
+    }
 
-        public void onInitiationFailed(Exception e)  {
+    @ReactMethod
+    public void verify(final String code, final double timeout, final Callback callback) {
+        UiThreadUtil.runOnUiThread(new Runnable() {
+            public void run() {
+                MyVerificationListener listener = sListener;
+                if (sVerification == null || listener == null) {
+                    callback.invoke("Verification object not found. Did you call flashCall() or sms() first?", null);
+                    return;
+                }
+                record(SessionRecorder.EVENT_VERIFY, null);
+                sCallback = callback;
+                listener.handle(SinchVerificationCore.EVENT_VERIFYING);
+                startDeadline(timeout);
+                sVerification.verify(code);
+            }
+        });
+    }
+
+    /**
+     * Starts a session in the core for the number, formatted to E.164 with the
+     * given region or the device's one. Returns null, after invoking the
+     * callback with the error, if the number is invalid or rate limited.
+     */
+    private SinchVerificationCore.Prepared prepare(String method, String phoneNumber, String region, Callback callback) {
+        // the SDK intercepts the sms / detects the call, completing the verification by itself
+        SinchVerificationCore.Prepared prepared = SinchVerificationCore.prepare(
+                method, phoneNumber, region, PhoneNumberUtils.getDefaultCountryIso(mContext), true);
+        if (SinchVerificationCore.PREPARE_INVALID_NUMBER.equals(prepared.status)) {
+            WritableMap map = Arguments.createMap();
+            map.putString("code", "invalid_number");
+            map.putString("message", "Invalid phone number");
+            callback.invoke(map, null);
+            return null;
+        }
+        if (SinchVerificationCore.PREPARE_RATE_LIMITED.equals(prepared.status)) {
             WritableMap map = Arguments.createMap();
-            map.putString("message", e.getMessage());
-            consumeCallback(false, map);
+            map.putString("code", "rate_limited");
+            map.putString("message", "Too many verification attempts for this number, try again later");
+            callback.invoke(map, null);
+            return null;
+        }
+        return prepared;
+    }
+
+    /**
+     * Arms a deadline (in ms, 0 for none) for what the callback is waiting for:
+     * the whole verification for sms() / flashCall(), which the SDK completes
+     * by itself once the sms is intercepted or the call detected, the code
+     * check for verify(). On expiry the verification is abandoned, since the
+     * SDK has no cancel, and the callback receives a {code: "timeout"} error.
+     * Main thread only.
+     */
+    private static void startDeadline(final double timeout) {
+        cancelDeadline();
+        if (timeout <= 0) {
+            return;
+        }
+        final MyVerificationListener listener = sListener;
+        sTimeout = TimeoutWheel.shared().schedule((long) timeout, new Runnable() {
+            public void run() {
+                sTimeout = null;
+                if (listener != sListener) {
+                    return;
+                }
+                listener.cancel();
+                listener.handle(SinchVerificationCore.EVENT_TIMED_OUT);
+                WritableMap map = Arguments.createMap();
+                map.putString("code", "timeout");
+                map.putString("message", "Verification timed out after " + (long) timeout + "ms");
+                consumeCallback(false, map);
+                sListener = null;
+                sVerification = null;
+            }
+        });
+    }
+
+    private static void cancelDeadline() {
+        if (sTimeout != null) {
+            sTimeout.cancel();
+            sTimeout = null;
+        }
+    }
+
+    private static void consumeCallback(Boolean success, WritableMap payload) {
+        if (sCallback == null && sVerification != null) {
+            String code = payload != null && payload.hasKey("code") ? payload.getString("code") : null;
+            String message = payload != null && payload.hasKey("message") ? payload.getString("message") : null;
+            SinchVerificationCore.savePending(success, code, message);
+        } else if (sCallback != null) {
+            cancelDeadline();
+            if (success) {
+                sCallback.invoke(null, payload);
+            } else {
+                sCallback.invoke(payload, null);
+            }
+            sCallback = null;
+        }
+    }
+
+    /**
+     * Forwards the SDK callbacks to the main thread, where the rest of the
+     * session state lives, and drives the core session with them. Results the
+     * session accepts go to the sink. A replay listener drives a replay-only
+     * session and records nothing.
+     */
+    private static class MyVerificationListener implements VerificationListener{
+
+        private final long mSessionId;
+        private final boolean mReplay;
+        private final ResultSink mSink;
+        private boolean mCancelled;
+
+        MyVerificationListener(long sessionId, boolean replay, ResultSink sink) {
+            mSessionId = sessionId;
+            mReplay = replay;
+            mSink = sink;
+        }
+
+        boolean handle(int event) {
+            return mReplay ? SinchVerificationCore.handleReplay(mSessionId, event) : SinchVerificationCore.handle(mSessionId, event);
+        }
+
+        private void record(String event, String message) {
+            if (!mReplay) {
+                SinchVerificationModule.record(event, message);
+            }
+        }
+
+        // callbacks arriving after a timeout, reset or a newer verification belong to an abandoned one
+        void cancel() {
+            mCancelled = true;
+        }
+
+        public void onInitiated() {
+            UiThreadUtil.runOnUiThread(new Runnable() {
+                public void run() {
+                    initiated();
+                }
+            });
+        }
+
+        public void onInitiationFailed(final Exception e) {
+            UiThreadUtil.runOnUiThread(new Runnable() {
+                public void run() {
+                    initiationFailed(e);
+                }
+            });
         }
 
         public void onVerified() {
-            consumeCallback(true, null);
+            UiThreadUtil.runOnUiThread(new Runnable() {
+                public void run() {
+                    verified();
+                }
+            });
         }
 
-        public void onVerificationFailed(Exception e) {
-            WritableMap map = Arguments.createMap();
+        public void onVerificationFailed(final Exception e) {
+            UiThreadUtil.runOnUiThread(new Runnable() {
+                public void run() {
+                    verificationFailed(e);
+                }
+            });
+        }
+
+        private void initiated() {
+            if (mCancelled) {
+                return;
+            }
+            // the deadline keeps running, the callback waits for the sms / call to complete the verification
+            record(SessionRecorder.EVENT_INITIATED, null);
+            handle(SinchVerificationCore.EVENT_INITIATED);
+        }
+
+        private void initiationFailed(Exception e) {
+            if (mCancelled) {
+                return;
+            }
+            record(SessionRecorder.EVENT_INITIATION_FAILED, e.getMessage());
+            if (handle(SinchVerificationCore.EVENT_INITIATION_FAILED)) {
+                mSink.deliver(false, failurePayload(e));
+            }
+        }
+
+        private void verified() {
+            if (mCancelled) {
+                return;
+            }
+            record(SessionRecorder.EVENT_VERIFIED, null);
+            if (handle(SinchVerificationCore.EVENT_VERIFIED)) {
+                mSink.deliver(true, null);
+            }
+        }
+
+        private void verificationFailed(Exception e) {
+            if (mCancelled) {
+                return;
+            }
+            record(SessionRecorder.EVENT_VERIFICATION_FAILED, e.getMessage());
             if (e instanceof InvalidInputException) {
                 // Incorrect number or code provided
             } else if (e instanceof CodeInterceptionException) {
@@ -121,8 +572,10 @@ public class SinchVerificationModule extends ReactContextBaseJavaModule {
             } else {
                 // Other system error, such as UnknownHostException in case of network error
             }
-			map.putString("message", e.getMessage());
-            consumeCallback(false, map);
+            // only results the session accepted reach the callback, which may belong to a newer verification
+            if (handle(SinchVerificationCore.EVENT_VERIFICATION_FAILED)) {
+                mSink.deliver(false, failurePayload(e));
+            }
         }
     }
 }
@@ -0,0 +1,105 @@
+package com.kevinresol.sinchverification;
+
+import android.os.Handler;
+import android.os.Looper;
+
+import java.util.ArrayList;
+import java.util.Iterator;
+import java.util.List;
+
+/**
+ * Hashed timer wheel shared by all verification calls. Instead of posting one
+ * delayed runnable per call, deadlines are dropped into slots and a single tick
+ * runs on the main looper, only while there is something pending.
+ *
+ * Deadlines are accurate to one tick. Not thread safe, use from the main thread only.
+ */
+class TimeoutWheel {
+
+    private static final long TICK_MS = 100;
+    private static final int SLOTS = 64;
+
+    private static TimeoutWheel sShared;
+
+    static TimeoutWheel shared() {
+        if (sShared == null) {
+            sShared = new TimeoutWheel(new Handler(Looper.getMainLooper()));
+        }
+        return sShared;
+    }
+
+    class Timeout {
+        private final Runnable mTask;
+        private long mRounds;
+        private boolean mCancelled;
+
+        private Timeout(Runnable task, long rounds) {
+            mTask = task;
+            mRounds = rounds;
+        }
+
+        void cancel() {
+            if (!mCancelled) {
+                mCancelled = true;
+                mPending--;
+            }
+        }
+    }
+
+    private final Handler mHandler;
+    private final List<List<Timeout>> mSlots = new ArrayList<>(SLOTS);
+    private int mCursor;
+    private int mPending;
+    private boolean mTicking;
+
+    private final Runnable mTick = new Runnable() {
+        public void run() {
+            mCursor = (mCursor + 1) % SLOTS;
+            List<Timeout> expired = new ArrayList<>();
+            Iterator<Timeout> it = mSlots.get(mCursor).iterator();
+            while (it.hasNext()) {
+                Timeout timeout = it.next();
+                if (timeout.mCancelled) {
+                    it.remove();
+                } else if (timeout.mRounds > 0) {
+                    timeout.mRounds--;
+                } else {
+                    it.remove();
+                    timeout.cancel();
+                    expired.add(timeout);
+                }
+            }
+            // run after the sweep, tasks may schedule new timeouts
+            for (Timeout timeout : expired) {
+                timeout.mTask.run();
+            }
+            if (mPending > 0) {
+                mHandler.postDelayed(this, TICK_MS);
+            } else {
+                mTicking = false;
+                for (List<Timeout> slot : mSlots) {
+                    slot.clear();
+                }
+            }
+        }
+    };
+
+    TimeoutWheel(Handler handler) {
+        mHandler = handler;
+        for (int i = 0; i < SLOTS; i++) {
+            mSlots.add(new ArrayList<Timeout>());
+        }
+    }
+
+    Timeout schedule(long delayMs, Runnable task) {
+        long ticks = Math.max(1, (delayMs + TICK_MS - 1) / TICK_MS);
+        Timeout timeout = new Timeout(task, (ticks - 1) / SLOTS);
+        mSlots.get((int) ((mCursor + ticks) % SLOTS)).add(timeout);
+        mPending++;
+        if (!mTicking) {
+            mTicking = true;
+            mHandler.postDelayed(mTick, TICK_MS);
+        }
+        return timeout;
+    }
+}
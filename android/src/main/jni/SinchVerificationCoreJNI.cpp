@@ -0,0 +1,148 @@
+#include <jni.h>
+
+#include <cstdio>
+#include <string>
+
+#include "SinchVerificationCore.h"
+
+// JNI shim for com.kevinresol.sinchverification.SinchVerificationCore
+
+using namespace sinchverification;
+
+static std::string toString(JNIEnv *env, jstring value) {
+    if (!value) {
+        return std::string();
+    }
+    const char *chars = env->GetStringUTFChars(value, NULL);
+    std::string result(chars ? chars : "");
+    env->ReleaseStringUTFChars(value, chars);
+    return result;
+}
+
+static jobjectArray toArray(JNIEnv *env, const std::string *values, jsize count) {
+    jobjectArray result = env->NewObjectArray(count, env->FindClass("java/lang/String"), NULL);
+    for (jsize i = 0; i < count; i++) {
+        jstring value = env->NewStringUTF(values[i].c_str());
+        env->SetObjectArrayElement(result, i, value);
+        env->DeleteLocalRef(value);
+    }
+    return result;
+}
+
+static const char *const PREPARE_STATUS[] = {"ok", "invalid_number", "rate_limited"};
+static const char *const RESUME_STATUS[] = {"none", "pending", "in_flight", "initiated", "lost"};
+
+extern "C" {
+
+JNIEXPORT void JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_setStoragePath(JNIEnv *env, jclass, jstring path) {
+    Core::shared().setStoragePath(toString(env, path));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_setRateLimit(JNIEnv *, jclass, jint maxAttempts, jdouble windowMs) {
+    Core::shared().limiter.setLimit(maxAttempts > 0 ? maxAttempts : 0,
+                                    std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(windowMs)));
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_nativePrepare(JNIEnv *env, jclass cls, jstring method, jstring phoneNumber,
+                                                                          jstring preferredRegion, jstring deviceRegion, jboolean automatic) {
+    // the SDK formatter lives on the Java side, called back on cache misses
+    jmethodID format = env->GetStaticMethodID(cls, "formatNumberToE164", "(Ljava/lang/String;Ljava/lang/String;)Ljava/lang/String;");
+    Core::Formatter formatter = [env, cls, format](const std::string &raw, const std::string &region, std::string &e164) {
+        jstring rawValue = env->NewStringUTF(raw.c_str());
+        jstring regionValue = env->NewStringUTF(region.c_str());
+        jstring result = (jstring) env->CallStaticObjectMethod(cls, format, rawValue, regionValue);
+        env->DeleteLocalRef(rawValue);
+        env->DeleteLocalRef(regionValue);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            return false;
+        }
+        e164 = toString(env, result);
+        env->DeleteLocalRef(result);
+        return !e164.empty();
+    };
+    Prepared prepared = Core::shared().prepare(toString(env, method), toString(env, phoneNumber), toString(env, preferredRegion),
+                                               toString(env, deviceRegion), automatic, formatter);
+    // gnustl has neither std::to_string nor std::snprintf
+    char sessionId[24];
+    snprintf(sessionId, sizeof(sessionId), "%lld", (long long) prepared.sessionId);
+    std::string values[] = {PREPARE_STATUS[prepared.status], sessionId, prepared.phoneNumber};
+    return toArray(env, values, 3);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_handle(JNIEnv *, jclass, jlong id, jint event) {
+    return Core::shared().handle(id, static_cast<SessionEvent>(event));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_reset(JNIEnv *, jclass) {
+    Core::shared().reset();
+}
+
+// replay() sessions, kept apart from the live one: not persisted, no rate limit
+static Core &replayCore() {
+    static Core core;
+    static bool configured = (core.limiter.setLimit(0, Clock::duration::zero()), true);
+    (void) configured;
+    return core;
+}
+
+// recordings do not keep the number, the placeholder is taken as is
+static bool replayFormatter(const std::string &raw, const std::string &, std::string &e164) {
+    e164 = raw;
+    return true;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_beginReplay(JNIEnv *env, jclass, jstring method, jboolean automatic) {
+    return replayCore().prepare(toString(env, method), "+0", "", "", automatic, replayFormatter).sessionId;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_handleReplay(JNIEnv *, jclass, jlong id, jint event) {
+    return replayCore().handle(id, static_cast<SessionEvent>(event));
+}
+
+JNIEXPORT void JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_savePending(JNIEnv *env, jclass, jboolean success, jstring code, jstring message) {
+    Result result;
+    result.success = success;
+    result.code = toString(env, code);
+    result.message = toString(env, message);
+    Core::shared().savePending(result);
+}
+
+JNIEXPORT jobjectArray JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_nativeResume(JNIEnv *env, jclass) {
+    Resume resume = Core::shared().resume();
+    std::string values[] = {RESUME_STATUS[resume.status], resume.result.success ? "1" : "0", resume.result.code,
+                            resume.result.message, resume.method, resume.phoneNumber};
+    return toArray(env, values, 6);
+}
+
+JNIEXPORT jdoubleArray JNICALL
+Java_com_kevinresol_sinchverification_SinchVerificationCore_metrics(JNIEnv *env, jclass) {
+    Metrics metrics = Core::shared().metrics();
+    jdouble values[] = {
+        (jdouble) metrics.initiations,
+        (jdouble) metrics.verified,
+        (jdouble) metrics.failed,
+        (jdouble) metrics.timedOut,
+        (jdouble) metrics.cancelled,
+        (jdouble) metrics.rateLimited,
+        (jdouble) metrics.cacheHits,
+        (jdouble) metrics.cacheMisses,
+        metrics.meanLatencyMs,
+        metrics.maxLatencyMs,
+    };
+    jsize count = sizeof(values) / sizeof(values[0]);
+    jdoubleArray result = env->NewDoubleArray(count);
+    env->SetDoubleArrayRegion(result, 0, count, values);
+    return result;
+}
+
+}
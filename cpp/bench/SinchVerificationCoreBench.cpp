@@ -0,0 +1,72 @@
+#include "SinchVerificationCore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Rough per-operation cost of the core, run with ./sinch_verification_core_bench
+
+using namespace sinchverification;
+
+template <typename F>
+static void bench(const char *name, int iterations, F f) {
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    std::printf("%-28s %10.1f ns/op\n", name, ns / iterations);
+}
+
+int main() {
+    const int iterations = 1000000;
+    std::vector<std::string> numbers;
+    for (int i = 0; i < 1000; i++) {
+        numbers.push_back("0701234" + std::to_string(1000 + i));
+    }
+
+    NumberCache cache;
+    std::string e164;
+    for (int i = 0; i < 200; i++) {
+        cache.store(numbers[i], "SE", "+46" + numbers[i].substr(1));
+    }
+    bench("NumberCache::lookup hit", iterations, [&](int i) {
+        cache.lookup(numbers[i % 200], "SE", e164);
+    });
+    bench("NumberCache::lookup miss", iterations, [&](int i) {
+        cache.lookup(numbers[200 + i % 800], "SE", e164);
+    });
+    bench("NumberCache::store evicting", iterations, [&](int i) {
+        cache.store(numbers[i % 1000], "SE", e164);
+    });
+
+    RateLimiter limiter;
+    Clock::time_point now = Clock::now();
+    bench("RateLimiter::tryAcquire", iterations, [&](int i) {
+        limiter.tryAcquire(numbers[i % 1000], now + std::chrono::milliseconds(i));
+    });
+
+    SessionRegistry sessions;
+    bench("SessionRegistry lifecycle", iterations, [&](int i) {
+        int64_t id = sessions.begin("sms", numbers[i % 1000], false, now);
+        sessions.handle(id, EventInitiated, now);
+        sessions.handle(id, EventVerifying, now);
+        sessions.handle(id, EventVerified, now + std::chrono::milliseconds(i % 5000));
+    });
+
+    Core core;
+    core.limiter.setLimit(0, Clock::duration::zero());
+    Core::Formatter formatter = [](const std::string &raw, const std::string &, std::string &e164) {
+        e164 = "+46" + raw.substr(1);
+        return true;
+    };
+    bench("Core::prepare cached", iterations, [&](int i) {
+        core.prepare("sms", numbers[i % 200], "", "se", false, formatter);
+    });
+
+    Metrics metrics = sessions.metrics();
+    std::printf("sessions verified %llu, mean latency %.1f ms\n",
+                (unsigned long long) metrics.verified, metrics.meanLatencyMs);
+    return 0;
+}
@@ -0,0 +1,408 @@
+#include "SinchVerificationCore.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+
+namespace sinchverification {
+
+NumberCache::NumberCache(size_t capacity)
+    : mCapacity(std::max<size_t>(capacity, 1)), mHits(0), mMisses(0) {
+}
+
+static std::string cacheKey(const std::string &raw, const std::string &region) {
+    return region + '\x1f' + raw;
+}
+
+bool NumberCache::lookup(const std::string &raw, const std::string &region, std::string &e164) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::unordered_map<std::string, Entries::iterator>::iterator it = mIndex.find(cacheKey(raw, region));
+    if (it == mIndex.end()) {
+        mMisses++;
+        return false;
+    }
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    e164 = it->second->second;
+    mHits++;
+    return true;
+}
+
+void NumberCache::store(const std::string &raw, const std::string &region, const std::string &e164) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::string key = cacheKey(raw, region);
+    std::unordered_map<std::string, Entries::iterator>::iterator it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        it->second->second = e164;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return;
+    }
+    mEntries.push_front(std::make_pair(key, e164));
+    mIndex[key] = mEntries.begin();
+    if (mEntries.size() > mCapacity) {
+        mIndex.erase(mEntries.back().first);
+        mEntries.pop_back();
+    }
+}
+
+void NumberCache::clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mIndex.clear();
+}
+
+size_t NumberCache::size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+uint64_t NumberCache::hits() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+uint64_t NumberCache::misses() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMisses;
+}
+
+// how many acquisitions between sweeps of numbers with no attempt left in the window
+static const unsigned RATE_LIMITER_PRUNE_INTERVAL = 64;
+
+RateLimiter::RateLimiter(size_t maxAttempts, Clock::duration window)
+    : mMaxAttempts(maxAttempts), mWindow(window), mSincePrune(0) {
+}
+
+void RateLimiter::setLimit(size_t maxAttempts, Clock::duration window) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMaxAttempts = maxAttempts;
+    mWindow = window;
+    mAttempts.clear();
+}
+
+bool RateLimiter::tryAcquire(const std::string &phoneNumber, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mMaxAttempts == 0) {
+        return true;
+    }
+    if (++mSincePrune >= RATE_LIMITER_PRUNE_INTERVAL) {
+        prune(now);
+    }
+    std::deque<Clock::time_point> &attempts = mAttempts[phoneNumber];
+    while (!attempts.empty() && now - attempts.front() >= mWindow) {
+        attempts.pop_front();
+    }
+    if (attempts.size() >= mMaxAttempts) {
+        return false;
+    }
+    attempts.push_back(now);
+    return true;
+}
+
+void RateLimiter::prune(Clock::time_point now) {
+    mSincePrune = 0;
+    for (std::unordered_map<std::string, std::deque<Clock::time_point> >::iterator it = mAttempts.begin();
+         it != mAttempts.end();) {
+        if (it->second.empty() || now - it->second.back() >= mWindow) {
+            it = mAttempts.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RateLimiter::reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mAttempts.clear();
+}
+
+size_t RateLimiter::size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mAttempts.size();
+}
+
+Session::Session()
+    : id(0), state(SessionNone), automatic(false) {
+}
+
+bool Session::open() const {
+    return state == SessionInitiating || state == SessionInitiated || state == SessionVerifying;
+}
+
+bool Session::awaiting() const {
+    return state == SessionInitiating || state == SessionVerifying || (state == SessionInitiated && automatic);
+}
+
+SessionRegistry::SessionRegistry()
+    : mNextId(1), mMetrics(), mLatencyTotalMs(0) {
+}
+
+int64_t SessionRegistry::begin(const std::string &method, const std::string &phoneNumber, bool automatic,
+                               Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCurrent.open()) {
+        close(SessionCancelled);
+    }
+    mCurrent = Session();
+    mCurrent.id = mNextId++;
+    mCurrent.method = method;
+    mCurrent.phoneNumber = phoneNumber;
+    mCurrent.state = SessionInitiating;
+    mCurrent.automatic = automatic;
+    mCurrent.startedAt = now;
+    mMetrics.initiations++;
+    return mCurrent.id;
+}
+
+bool SessionRegistry::handle(int64_t id, SessionEvent event, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (id == 0 || id != mCurrent.id || !mCurrent.open()) {
+        return false;
+    }
+    SessionState state = mCurrent.state;
+    switch (event) {
+        case EventInitiated:
+            if (state != SessionInitiating) {
+                return false;
+            }
+            mCurrent.state = SessionInitiated;
+            return true;
+        case EventInitiationFailed:
+            if (state != SessionInitiating) {
+                return false;
+            }
+            mMetrics.failed++;
+            close(SessionFailed);
+            return true;
+        case EventVerifying:
+            if (state != SessionInitiated) {
+                return false;
+            }
+            mCurrent.state = SessionVerifying;
+            return true;
+        case EventVerified: {
+            double latency = std::chrono::duration<double, std::milli>(now - mCurrent.startedAt).count();
+            mMetrics.verified++;
+            mLatencyTotalMs += latency;
+            mMetrics.meanLatencyMs = mLatencyTotalMs / mMetrics.verified;
+            mMetrics.maxLatencyMs = std::max(mMetrics.maxLatencyMs, latency);
+            close(SessionVerified);
+            return true;
+        }
+        case EventVerificationFailed:
+            // a wrong code or failed interception, the code can still be entered with verify()
+            mMetrics.failed++;
+            mCurrent.state = SessionInitiated;
+            mCurrent.automatic = false;
+            return true;
+        case EventTimedOut:
+            mMetrics.timedOut++;
+            close(SessionTimedOut);
+            return true;
+        case EventCancelled:
+            close(SessionCancelled);
+            return true;
+    }
+    return false;
+}
+
+void SessionRegistry::cancel() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCurrent.open()) {
+        close(SessionCancelled);
+    }
+}
+
+void SessionRegistry::close(SessionState state) {
+    if (state == SessionCancelled) {
+        mMetrics.cancelled++;
+    }
+    mCurrent = Session();
+}
+
+Session SessionRegistry::current() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCurrent;
+}
+
+void SessionRegistry::countRateLimited() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMetrics.rateLimited++;
+}
+
+Metrics SessionRegistry::metrics() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMetrics;
+}
+
+Result::Result()
+    : success(false) {
+}
+
+Core &Core::shared() {
+    static Core core;
+    return core;
+}
+
+Core::Core()
+    : mHasPending(false) {
+}
+
+// values are single line, the storage file is one key=value per line
+static std::string singleLine(std::string value) {
+    std::replace(value.begin(), value.end(), '\n', ' ');
+    std::replace(value.begin(), value.end(), '\r', ' ');
+    return value;
+}
+
+void Core::setStoragePath(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStoragePath = path;
+
+    std::ifstream in(path.c_str());
+    std::map<std::string, std::string> values;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t separator = line.find('=');
+        if (separator != std::string::npos) {
+            values[line.substr(0, separator)] = line.substr(separator + 1);
+        }
+    }
+
+    if (!values["method"].empty() && !sessions.current().open() && !mRestored.open()) {
+        mRestored = Session();
+        mRestored.id = -1;
+        mRestored.method = values["method"];
+        mRestored.phoneNumber = values["phoneNumber"];
+        mRestored.state = static_cast<SessionState>(std::atoi(values["state"].c_str()));
+        mRestored.automatic = values["automatic"] == "1";
+        if (!mRestored.open()) {
+            mRestored = Session();
+        }
+    }
+    if (values["pending"] == "1" && !mHasPending) {
+        mHasPending = true;
+        mPending.success = values["pendingSuccess"] == "1";
+        mPending.code = values["pendingCode"];
+        mPending.message = values["pendingMessage"];
+    }
+}
+
+std::string Core::resolveRegion(const std::string &preferred, const std::string &device) {
+    std::string region = preferred.empty() ? device : preferred;
+    std::transform(region.begin(), region.end(), region.begin(), ::toupper);
+    return region;
+}
+
+Prepared Core::prepare(const std::string &method, const std::string &raw, const std::string &preferredRegion,
+                       const std::string &deviceRegion, bool automatic, const Formatter &formatter) {
+    Prepared prepared;
+    prepared.status = PrepareInvalidNumber;
+    prepared.sessionId = 0;
+
+    std::string region = resolveRegion(preferredRegion, deviceRegion);
+    if (raw.empty()) {
+        return prepared;
+    }
+    if (!numbers.lookup(raw, region, prepared.phoneNumber)) {
+        if (!formatter(raw, region, prepared.phoneNumber) || prepared.phoneNumber.empty()) {
+            prepared.phoneNumber.clear();
+            return prepared;
+        }
+        numbers.store(raw, region, prepared.phoneNumber);
+    }
+
+    if (!limiter.tryAcquire(prepared.phoneNumber)) {
+        sessions.countRateLimited();
+        prepared.status = PrepareRateLimited;
+        return prepared;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    prepared.status = PrepareOk;
+    prepared.sessionId = sessions.begin(method, prepared.phoneNumber, automatic);
+    mRestored = Session();
+    mHasPending = false;
+    persist();
+    return prepared;
+}
+
+bool Core::handle(int64_t id, SessionEvent event) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool handled = sessions.handle(id, event);
+    if (handled) {
+        persist();
+    }
+    return handled;
+}
+
+void Core::reset() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    sessions.cancel();
+    mRestored = Session();
+    mHasPending = false;
+    persist();
+}
+
+void Core::savePending(const Result &result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mHasPending = true;
+    mPending = result;
+    persist();
+}
+
+Resume Core::resume() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Resume resume;
+    resume.status = ResumeNone;
+    Session current = sessions.current();
+    if (mHasPending) {
+        resume.status = ResumePending;
+        resume.result = mPending;
+        mHasPending = false;
+    } else if (current.open()) {
+        resume.status = current.awaiting() ? ResumeInFlight : ResumeInitiated;
+        resume.method = current.method;
+        resume.phoneNumber = current.phoneNumber;
+    } else if (mRestored.open()) {
+        resume.status = ResumeLost;
+        resume.method = mRestored.method;
+        resume.phoneNumber = mRestored.phoneNumber;
+        mRestored = Session();
+    }
+    persist();
+    return resume;
+}
+
+void Core::persist() {
+    if (mStoragePath.empty()) {
+        return;
+    }
+    Session current = sessions.current();
+    if (!current.open()) {
+        current = mRestored;
+    }
+    std::ofstream out(mStoragePath.c_str(), std::ios::trunc);
+    if (current.open()) {
+        out << "method=" << singleLine(current.method) << '\n'
+            << "phoneNumber=" << singleLine(current.phoneNumber) << '\n'
+            << "state=" << current.state << '\n'
+            << "automatic=" << (current.automatic ? 1 : 0) << '\n';
+    }
+    if (mHasPending) {
+        out << "pending=1\n"
+            << "pendingSuccess=" << (mPending.success ? 1 : 0) << '\n'
+            << "pendingCode=" << singleLine(mPending.code) << '\n'
+            << "pendingMessage=" << singleLine(mPending.message) << '\n';
+    }
+}
+
+Metrics Core::metrics() const {
+    Metrics result = sessions.metrics();
+    result.cacheHits = numbers.hits();
+    result.cacheMisses = numbers.misses();
+    return result;
+}
+
+}
@@ -0,0 +1,248 @@
+#ifndef SINCH_VERIFICATION_CORE_H
+#define SINCH_VERIFICATION_CORE_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Platform independent part of the verification bridges, shared by the
+ * Objective-C++ module on iOS and the JNI shim on Android.
+ *
+ * The core owns the verification session: number normalization (with the
+ * platform SDK plugged in as formatter), rate limiting, the session state
+ * machine, persistence of the session across process restarts and the
+ * decision of what resume() reports. The shims only hold what cannot leave
+ * the platform: the SDK verification object, the JS callback and the timer.
+ *
+ * All classes are thread-safe.
+ */
+namespace sinchverification {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Bounded LRU cache of (raw number, default region) -> E.164, so repeated
+ * calls for the same input skip the SDK parse/format round trip.
+ */
+class NumberCache {
+public:
+    explicit NumberCache(size_t capacity = 256);
+
+    // returns false on a miss
+    bool lookup(const std::string &raw, const std::string &region, std::string &e164);
+    void store(const std::string &raw, const std::string &region, const std::string &e164);
+    void clear();
+
+    size_t size() const;
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+private:
+    typedef std::list<std::pair<std::string, std::string> > Entries;
+
+    size_t mCapacity;
+    Entries mEntries;
+    std::unordered_map<std::string, Entries::iterator> mIndex;
+    uint64_t mHits;
+    uint64_t mMisses;
+    mutable std::mutex mMutex;
+};
+
+/**
+ * Limits how often a verification can be initiated for the same number, at
+ * most maxAttempts within a sliding window. A maxAttempts of 0 disables it.
+ */
+class RateLimiter {
+public:
+    RateLimiter(size_t maxAttempts = 5, Clock::duration window = std::chrono::minutes(10));
+
+    void setLimit(size_t maxAttempts, Clock::duration window);
+    // records the attempt and returns true if it is allowed
+    bool tryAcquire(const std::string &phoneNumber, Clock::time_point now = Clock::now());
+    void reset();
+
+    // numbers currently tracked, stale ones are dropped as the limiter is used
+    size_t size() const;
+
+private:
+    void prune(Clock::time_point now);
+
+    size_t mMaxAttempts;
+    Clock::duration mWindow;
+    std::unordered_map<std::string, std::deque<Clock::time_point> > mAttempts;
+    unsigned mSincePrune;
+    mutable std::mutex mMutex;
+};
+
+enum SessionState {
+    SessionNone,
+    SessionInitiating,
+    SessionInitiated,
+    SessionVerifying,
+    SessionVerified,
+    SessionFailed,
+    SessionTimedOut,
+    SessionCancelled,
+};
+
+// what the platform SDK (or the bridge) reported for a session
+enum SessionEvent {
+    EventInitiated,
+    EventInitiationFailed,
+    EventVerifying,
+    EventVerified,
+    EventVerificationFailed,
+    EventTimedOut,
+    EventCancelled,
+};
+
+struct Session {
+    Session();
+
+    int64_t id;     // 0 when there is no session
+    std::string method;
+    std::string phoneNumber;
+    SessionState state;
+    // the SDK completes the verification by itself after initiation (Android
+    // sms interception, flash call) rather than waiting for verify()
+    bool automatic;
+    Clock::time_point startedAt;
+
+    bool open() const;
+    // an SDK request is outstanding, its result is still to come
+    bool awaiting() const;
+};
+
+struct Metrics {
+    uint64_t initiations;
+    uint64_t verified;
+    uint64_t failed;        // every failure the SDK reported, initiation or verification
+    uint64_t timedOut;
+    uint64_t cancelled;
+    uint64_t rateLimited;
+    uint64_t cacheHits;
+    uint64_t cacheMisses;
+    double meanLatencyMs;   // initiation to verified
+    double maxLatencyMs;
+};
+
+/**
+ * State machine of the current verification session. There is at most one
+ * open session, like the bridges have one verification at a time; starting
+ * a new one cancels the previous.
+ */
+class SessionRegistry {
+public:
+    SessionRegistry();
+
+    int64_t begin(const std::string &method, const std::string &phoneNumber, bool automatic,
+                  Clock::time_point now = Clock::now());
+    // returns false if id is not the open session or the event is not valid in its state
+    bool handle(int64_t id, SessionEvent event, Clock::time_point now = Clock::now());
+    // cancels the open session, if any
+    void cancel();
+    // the open session, id is 0 if none
+    Session current() const;
+
+    void countRateLimited();
+    Metrics metrics() const;
+
+private:
+    void close(SessionState state);
+
+    int64_t mNextId;
+    Session mCurrent;
+    Metrics mMetrics;
+    double mLatencyTotalMs;
+    mutable std::mutex mMutex;
+};
+
+struct Result {
+    Result();
+
+    bool success;
+    std::string code;
+    std::string message;
+};
+
+enum PrepareStatus {
+    PrepareOk,
+    PrepareInvalidNumber,
+    PrepareRateLimited,
+};
+
+struct Prepared {
+    PrepareStatus status;
+    std::string phoneNumber;    // E.164
+    int64_t sessionId;
+};
+
+enum ResumeStatus {
+    ResumeNone,
+    ResumePending,      // result holds what the original callback would have received
+    ResumeInFlight,     // the result is still to come
+    ResumeInitiated,    // waiting for verify() with the received code
+    ResumeLost,         // the process was killed, the SDK objects are gone
+};
+
+struct Resume {
+    ResumeStatus status;
+    Result result;
+    std::string method;
+    std::string phoneNumber;
+};
+
+/**
+ * Process wide instance used by both platform shims.
+ */
+class Core {
+public:
+    // platform SDK parse + E.164 format, returns false if the number is invalid
+    typedef std::function<bool (const std::string &raw, const std::string &region, std::string &e164)> Formatter;
+
+    static Core &shared();
+
+    Core();
+
+    NumberCache numbers;
+    RateLimiter limiter;
+    SessionRegistry sessions;
+
+    // where the session is persisted, loads a session left by a previous process
+    void setStoragePath(const std::string &path);
+
+    static std::string resolveRegion(const std::string &preferred, const std::string &device);
+
+    // normalizes the number, applies the rate limit and starts a session
+    Prepared prepare(const std::string &method, const std::string &raw, const std::string &preferredRegion,
+                     const std::string &deviceRegion, bool automatic, const Formatter &formatter);
+    bool handle(int64_t id, SessionEvent event);
+    // cancels the session and drops a pending result
+    void reset();
+
+    // keeps a result that had no JS callback to go to, for resume()
+    void savePending(const Result &result);
+    Resume resume();
+
+    // registry metrics with the cache counters filled in
+    Metrics metrics() const;
+
+private:
+    void persist();
+
+    std::string mStoragePath;
+    bool mHasPending;
+    Result mPending;
+    Session mRestored;
+    std::mutex mMutex;
+};
+
+}
+
+#endif
@@ -0,0 +1,259 @@
+#include "SessionReplay.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <thread>
+
+namespace sinchverification {
+
+RecordedEvent::RecordedEvent()
+    : time(0), automatic(false) {
+}
+
+bool RecordedEvent::isCallback() const {
+    return name.compare(0, 2, "on") == 0;
+}
+
+// Just enough JSON for the recordings: one flat object of string and number
+// values per line, other values are skipped.
+class LineParser {
+public:
+    explicit LineParser(const std::string &line)
+        : mLine(line), mPos(0) {
+    }
+
+    bool parse(RecordedEvent &event) {
+        bool hasTime = false;
+        bool hasEvent = false;
+        bool hasAutomatic = false;
+        if (!consume('{')) {
+            return false;
+        }
+        if (consume('}')) {
+            return false;
+        }
+        do {
+            std::string key;
+            if (!string(key) || !consume(':')) {
+                return false;
+            }
+            skipSpace();
+            if (mPos < mLine.size() && mLine[mPos] == '"') {
+                std::string value;
+                if (!string(value)) {
+                    return false;
+                }
+                if (key == "event") {
+                    event.name = value;
+                    hasEvent = true;
+                } else if (key == "message") {
+                    event.message = value;
+                }
+            } else {
+                const char *start = mLine.c_str() + mPos;
+                char *end = NULL;
+                double value = std::strtod(start, &end);
+                if (end == start) {
+                    std::string value;
+                    if (!literal(value)) {
+                        return false;
+                    }
+                    if (key == "automatic" && value != "null") {
+                        event.automatic = value == "true";
+                        hasAutomatic = true;
+                    }
+                } else {
+                    mPos += end - start;
+                    if (key == "t") {
+                        event.time = value;
+                        hasTime = true;
+                    }
+                }
+            }
+        } while (consume(','));
+        if (!consume('}')) {
+            return false;
+        }
+        skipSpace();
+        if (!hasAutomatic) {
+            event.automatic = event.name == "flashCall";
+        }
+        return mPos == mLine.size() && hasTime && hasEvent;
+    }
+
+private:
+    void skipSpace() {
+        while (mPos < mLine.size() && std::isspace(static_cast<unsigned char>(mLine[mPos]))) {
+            mPos++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (mPos < mLine.size() && mLine[mPos] == c) {
+            mPos++;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(std::string &out) {
+        static const char *const literals[] = {"true", "false", "null"};
+        for (size_t i = 0; i < 3; i++) {
+            std::string literal(literals[i]);
+            if (mLine.compare(mPos, literal.size(), literal) == 0) {
+                mPos += literal.size();
+                out = literal;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void appendUtf8(std::string &out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    bool string(std::string &out) {
+        if (!consume('"')) {
+            return false;
+        }
+        while (mPos < mLine.size()) {
+            char c = mLine[mPos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (mPos >= mLine.size()) {
+                return false;
+            }
+            c = mLine[mPos++];
+            switch (c) {
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    if (mPos + 4 > mLine.size()) {
+                        return false;
+                    }
+                    char *end = NULL;
+                    std::string hex = mLine.substr(mPos, 4);
+                    unsigned code = std::strtoul(hex.c_str(), &end, 16);
+                    if (end != hex.c_str() + 4) {
+                        return false;
+                    }
+                    // surrogate pairs are not recombined, messages are for humans only
+                    appendUtf8(out, code);
+                    mPos += 4;
+                    break;
+                }
+                default: out += c; break;    // \" \\ \/
+            }
+        }
+        return false;
+    }
+
+    const std::string &mLine;
+    size_t mPos;
+};
+
+bool loadRecording(std::istream &in, std::vector<RecordedEvent> &events, size_t *errorLine) {
+    std::string line;
+    size_t number = 0;
+    while (std::getline(in, line)) {
+        number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        RecordedEvent event;
+        if (!LineParser(line).parse(event)) {
+            if (errorLine) {
+                *errorLine = number;
+            }
+            return false;
+        }
+        events.push_back(event);
+    }
+    return true;
+}
+
+ReplayReport::ReplayReport()
+    : events(0), verified(0), failed(0), rejected(0), recordedMs(0), elapsedMs(0), maxLagMs(0), meanHandleUs(0),
+      metrics() {
+}
+
+// recordings do not keep the number, the formatter accepts the placeholder as is
+static bool replayFormatter(const std::string &raw, const std::string &, std::string &e164) {
+    e164 = raw;
+    return true;
+}
+
+ReplayReport replay(const std::vector<RecordedEvent> &events, double speed, Core &core) {
+    ReplayReport report;
+    double handleTotalUs = 0;
+    int64_t sessionId = 0;
+    Clock::time_point start = Clock::now();
+
+    for (size_t i = 0; i < events.size(); i++) {
+        const RecordedEvent &event = events[i];
+        double dueMs = speed > 0 ? event.time / speed : 0;
+        Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(dueMs));
+        std::this_thread::sleep_until(due);
+        Clock::time_point dispatched = Clock::now();
+        report.recordedMs = std::max(report.recordedMs, event.time);
+
+        bool handled = true;
+        if (!sessionId && event.isCallback()) {
+            // the recording was started after sms() / flashCall()
+            sessionId = core.prepare("sms", "+0", "", "", false, replayFormatter).sessionId;
+        }
+        if (event.name == "sms" || event.name == "flashCall") {
+            sessionId = core.prepare(event.name, "+0", "", "", event.automatic, replayFormatter).sessionId;
+        } else if (event.name == "verify") {
+            core.handle(sessionId, EventVerifying);
+        } else if (event.isCallback()) {
+            report.events++;
+            report.maxLagMs = std::max(report.maxLagMs, std::chrono::duration<double, std::milli>(dispatched - due).count());
+            if (event.name == "onInitiated") {
+                handled = core.handle(sessionId, EventInitiated);
+            } else if (event.name == "onInitiationFailed") {
+                handled = core.handle(sessionId, EventInitiationFailed);
+                report.failed += handled;
+            } else if (event.name == "onVerified") {
+                handled = core.handle(sessionId, EventVerified);
+                report.verified += handled;
+            } else if (event.name == "onVerificationFailed") {
+                handled = core.handle(sessionId, EventVerificationFailed);
+                report.failed += handled;
+            } else {
+                handled = false;
+            }
+            handleTotalUs += std::chrono::duration<double, std::micro>(Clock::now() - dispatched).count();
+        }
+        if (!handled) {
+            report.rejected++;
+        }
+    }
+
+    report.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    report.meanHandleUs = report.events ? handleTotalUs / report.events : 0;
+    report.metrics = core.metrics();
+    return report;
+}
+
+}
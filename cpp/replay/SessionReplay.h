@@ -0,0 +1,59 @@
+#ifndef SINCH_VERIFICATION_SESSION_REPLAY_H
+#define SINCH_VERIFICATION_SESSION_REPLAY_H
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "SinchVerificationCore.h"
+
+/**
+ * Host side replay of sessions recorded by the bridges (record() in JS), so
+ * the timing of the SDK callbacks can be fed through the shared core on a
+ * Linux box, without a device or the Sinch backend.
+ *
+ * Recordings are JSON lines: {"t": ms since recording started, "event": name, "message": optional},
+ * sms and flashCall lines also have "automatic": bool
+ */
+namespace sinchverification {
+
+struct RecordedEvent {
+    RecordedEvent();
+
+    double time;            // ms
+    std::string name;       // sms, flashCall, verify, or a callback: onInitiated, ...
+    std::string message;
+    // sms and flashCall: the SDK completes the verification by itself (Android),
+    // taken from the recording, flashCall only if the recording does not say
+    bool automatic;
+
+    bool isCallback() const;
+};
+
+// returns false, with the 1-based line number in errorLine, on a malformed line
+bool loadRecording(std::istream &in, std::vector<RecordedEvent> &events, size_t *errorLine = NULL);
+
+struct ReplayReport {
+    ReplayReport();
+
+    size_t events;          // SDK callbacks replayed, like the bridges' replay()
+    size_t verified;        // verified / failure callbacks the session accepted
+    size_t failed;
+    size_t rejected;        // callbacks the session state machine did not accept
+    double recordedMs;
+    double elapsedMs;
+    double maxLagMs;        // how late a callback was dispatched compared to its due time
+    double meanHandleUs;    // time spent in the core per callback
+    Metrics metrics;
+};
+
+/**
+ * Feeds the recorded calls and callbacks into core at the original pace
+ * divided by speed, 0 for as fast as possible. The calls start sessions and
+ * mark verify(), the callbacks drive the session like the SDK listeners do.
+ */
+ReplayReport replay(const std::vector<RecordedEvent> &events, double speed, Core &core);
+
+}
+
+#endif
@@ -0,0 +1,54 @@
+#include "SessionReplay.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// Replays a recording through the core, run with
+// ./sinch_verification_replay <recording.jsonl> [speed]
+// speed 1 is the original pace, 0 (the default) is as fast as possible.
+
+using namespace sinchverification;
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <recording.jsonl> [speed]\n", argv[0]);
+        return 2;
+    }
+    double speed = argc > 2 ? std::atof(argv[2]) : 0;
+
+    std::ifstream in(argv[1]);
+    if (!in) {
+        std::fprintf(stderr, "Unable to read %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<RecordedEvent> events;
+    size_t errorLine = 0;
+    if (!loadRecording(in, events, &errorLine)) {
+        std::fprintf(stderr, "%s:%zu: malformed event\n", argv[1], errorLine);
+        return 1;
+    }
+
+    Core core;
+    core.limiter.setLimit(0, Clock::duration::zero());
+    ReplayReport report = replay(events, speed, core);
+    if (report.events == 0) {
+        std::fprintf(stderr, "No callbacks found in %s\n", argv[1]);
+        return 1;
+    }
+
+    std::printf("events        %zu\n", report.events);
+    std::printf("verified      %zu\n", report.verified);
+    std::printf("failed        %zu\n", report.failed);
+    std::printf("rejected      %zu\n", report.rejected);
+    std::printf("recordedMs    %.1f\n", report.recordedMs);
+    std::printf("elapsedMs     %.1f\n", report.elapsedMs);
+    std::printf("maxLagMs      %.3f\n", report.maxLagMs);
+    std::printf("meanHandleUs  %.3f\n", report.meanHandleUs);
+    std::printf("sessions      %llu initiated, %llu verified, %llu failed, %llu timed out, %llu cancelled\n",
+                (unsigned long long) report.metrics.initiations, (unsigned long long) report.metrics.verified,
+                (unsigned long long) report.metrics.failed, (unsigned long long) report.metrics.timedOut,
+                (unsigned long long) report.metrics.cancelled);
+    // callbacks the state machine refused point at a race or a broken recording
+    return report.rejected ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#include "SessionReplay.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// Unit tests of the recording parser and replay, run with ctest or ./sinch_verification_replay_test
+
+using namespace sinchverification;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static std::vector<RecordedEvent> load(const std::string &text, bool *ok = NULL, size_t *errorLine = NULL) {
+    std::istringstream in(text);
+    std::vector<RecordedEvent> events;
+    bool loaded = loadRecording(in, events, errorLine);
+    if (ok) {
+        *ok = loaded;
+    }
+    return events;
+}
+
+static void testLoadRecording() {
+    bool ok = false;
+    // as written by org.json on Android and NSJSONSerialization on iOS, keys in any order
+    std::vector<RecordedEvent> events = load(
+        "{\"t\":0,\"event\":\"sms\"}\n"
+        "\n"
+        "{\"event\":\"onVerificationFailed\", \"t\": 12.5, \"message\":\"Incorrect code \\\"12\\\"\\n\\u00e9\\/\"}\r\n"
+        "{\"t\":20,\"event\":\"onVerified\",\"extra\":null}\n", &ok);
+    CHECK(ok);
+    CHECK(events.size() == 3);
+    CHECK(events[0].name == "sms" && events[0].time == 0 && !events[0].isCallback());
+    CHECK(events[1].name == "onVerificationFailed" && events[1].time == 12.5 && events[1].isCallback());
+    CHECK(events[1].message == "Incorrect code \"12\"\n\xc3\xa9/");
+    CHECK(events[2].name == "onVerified" && events[2].message.empty());
+    // whether the session completes by itself, flashCall only when the recording does not say
+    CHECK(!events[0].automatic);
+    events = load("{\"t\":0,\"event\":\"sms\",\"automatic\":true}\n{\"t\":1,\"event\":\"flashCall\"}\n", &ok);
+    CHECK(ok && events.size() == 2 && events[0].automatic && events[1].automatic);
+
+    size_t errorLine = 0;
+    load("{\"t\":0,\"event\":\"sms\"}\n{\"t\":1}\n", &ok, &errorLine);
+    CHECK(!ok && errorLine == 2);
+    load("{\"t\":0,\"event\":\"sms\"\n", &ok, &errorLine);
+    CHECK(!ok && errorLine == 1);
+    load("{\"t\":0,\"event\":\"sms\"} trailing\n", &ok, &errorLine);
+    CHECK(!ok);
+}
+
+static void testReplay() {
+    std::vector<RecordedEvent> events = load(
+        "{\"t\":0,\"event\":\"sms\"}\n"
+        "{\"t\":10,\"event\":\"onInitiated\"}\n"
+        "{\"t\":20,\"event\":\"verify\"}\n"
+        "{\"t\":30,\"event\":\"onVerificationFailed\",\"message\":\"Incorrect code\"}\n"
+        "{\"t\":40,\"event\":\"verify\"}\n"
+        "{\"t\":50,\"event\":\"onVerified\"}\n"
+        // a late duplicate, the session is already closed
+        "{\"t\":60,\"event\":\"onVerified\"}\n");
+    Core core;
+    ReplayReport report = replay(events, 0, core);
+    CHECK(report.events == 4);
+    CHECK(report.verified == 1);
+    CHECK(report.failed == 1);
+    CHECK(report.rejected == 1);
+    CHECK(report.recordedMs == 60);
+    CHECK(report.metrics.initiations == 1);
+    CHECK(report.metrics.verified == 1);
+    CHECK(report.metrics.failed == 1);
+
+    // paced replay takes the recorded time divided by speed
+    Core paced;
+    report = replay(events, 2, paced);
+    CHECK(report.elapsedMs >= 30);
+    CHECK(report.maxLagMs >= 0);
+
+    // an automatic (Android) sms session is awaiting its result after initiation, like on the device
+    Core automatic;
+    std::vector<RecordedEvent> android = load(
+        "{\"t\":0,\"event\":\"sms\",\"automatic\":true}\n"
+        "{\"t\":10,\"event\":\"onInitiated\"}\n");
+    report = replay(android, 0, automatic);
+    CHECK(report.rejected == 0);
+    CHECK(automatic.sessions.current().awaiting());
+
+    // callbacks of a recording started mid-session get a session of their own
+    Core partial;
+    report = replay(load("{\"t\":0,\"event\":\"onInitiated\"}\n{\"t\":5,\"event\":\"onVerified\"}\n"), 0, partial);
+    CHECK(report.rejected == 0);
+    CHECK(report.metrics.verified == 1);
+}
+
+int main() {
+    testLoadRecording();
+    testReplay();
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all tests passed\n");
+    return 0;
+}
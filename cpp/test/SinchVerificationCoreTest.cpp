@@ -0,0 +1,253 @@
+#include "SinchVerificationCore.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// Unit tests of the core, run with ctest or ./sinch_verification_core_test
+
+using namespace sinchverification;
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while (0)
+
+static void testNumberCacheEviction() {
+    NumberCache cache(2);
+    std::string e164;
+    cache.store("0701", "SE", "+46701");
+    cache.store("0702", "SE", "+46702");
+    cache.store("0703", "SE", "+46703");
+    CHECK(cache.size() == 2);
+    CHECK(!cache.lookup("0701", "SE", e164));
+    CHECK(cache.lookup("0703", "SE", e164) && e164 == "+46703");
+    // the region is part of the key
+    CHECK(!cache.lookup("0703", "US", e164));
+    CHECK(cache.hits() == 1);
+    CHECK(cache.misses() == 2);
+}
+
+static void testNumberCachePromotion() {
+    NumberCache cache(2);
+    std::string e164;
+    cache.store("0701", "SE", "+46701");
+    cache.store("0702", "SE", "+46702");
+    // a lookup makes 0701 the most recently used, 0702 is evicted next
+    CHECK(cache.lookup("0701", "SE", e164));
+    cache.store("0703", "SE", "+46703");
+    CHECK(cache.lookup("0701", "SE", e164) && e164 == "+46701");
+    CHECK(!cache.lookup("0702", "SE", e164));
+
+    // so does storing an existing entry again, which also updates it
+    cache.store("0703", "SE", "+46703x");
+    cache.store("0701", "SE", "+46701x");
+    cache.store("0704", "SE", "+46704");
+    CHECK(cache.lookup("0701", "SE", e164) && e164 == "+46701x");
+    CHECK(!cache.lookup("0703", "SE", e164));
+}
+
+static void testRateLimiterWindow() {
+    Clock::time_point now = Clock::now();
+    RateLimiter limiter(2, std::chrono::seconds(10));
+    CHECK(limiter.tryAcquire("+46701", now));
+    CHECK(limiter.tryAcquire("+46701", now + std::chrono::seconds(4)));
+    CHECK(!limiter.tryAcquire("+46701", now + std::chrono::seconds(5)));
+    // other numbers have their own window
+    CHECK(limiter.tryAcquire("+46702", now + std::chrono::seconds(5)));
+    // the first attempt slides out of the window, the second one is still in it
+    CHECK(limiter.tryAcquire("+46701", now + std::chrono::seconds(10)));
+    CHECK(!limiter.tryAcquire("+46701", now + std::chrono::seconds(13)));
+    CHECK(limiter.tryAcquire("+46701", now + std::chrono::seconds(14)));
+
+    limiter.reset();
+    CHECK(limiter.size() == 0);
+    CHECK(limiter.tryAcquire("+46701", now + std::chrono::seconds(14)));
+
+    limiter.setLimit(0, Clock::duration::zero());
+    for (int i = 0; i < 10; i++) {
+        CHECK(limiter.tryAcquire("+46701", now));
+    }
+}
+
+static void testRateLimiterPrune() {
+    Clock::time_point now = Clock::now();
+    RateLimiter limiter(1, std::chrono::seconds(1));
+    for (int i = 0; i < 100; i++) {
+        limiter.tryAcquire("+4670" + std::to_string(i), now);
+    }
+    CHECK(limiter.size() == 100);
+    // numbers whose attempts all left the window are dropped as the limiter is used
+    for (int i = 0; i < 100; i++) {
+        limiter.tryAcquire("+4671", now + std::chrono::seconds(2));
+    }
+    CHECK(limiter.size() == 1);
+}
+
+static void testSessionTransitions() {
+    Clock::time_point now = Clock::now();
+    SessionRegistry sessions;
+    CHECK(sessions.current().id == 0);
+
+    int64_t id = sessions.begin("sms", "+46701", false, now);
+    CHECK(sessions.current().id == id);
+    CHECK(sessions.current().state == SessionInitiating);
+    CHECK(sessions.current().awaiting());
+    // verify() before initiation completed is not a valid transition
+    CHECK(!sessions.handle(id, EventVerifying, now));
+    CHECK(sessions.handle(id, EventInitiated, now));
+    CHECK(!sessions.current().awaiting());
+    CHECK(!sessions.handle(id, EventInitiated, now));
+    CHECK(sessions.handle(id, EventVerifying, now));
+    CHECK(sessions.handle(id, EventVerificationFailed, now));
+    CHECK(sessions.current().state == SessionInitiated);
+    CHECK(sessions.handle(id, EventVerifying, now));
+    CHECK(sessions.handle(id, EventVerified, now + std::chrono::milliseconds(300)));
+    CHECK(sessions.current().id == 0);
+    // closed sessions do not take events anymore
+    CHECK(!sessions.handle(id, EventVerified, now));
+
+    id = sessions.begin("flashCall", "+46702", true, now);
+    CHECK(sessions.handle(id, EventInitiated, now));
+    CHECK(sessions.current().awaiting());
+    CHECK(sessions.handle(id, EventVerified, now + std::chrono::milliseconds(100)));
+
+    id = sessions.begin("sms", "+46703", false, now);
+    CHECK(sessions.handle(id, EventInitiationFailed, now));
+
+    id = sessions.begin("sms", "+46704", false, now);
+    CHECK(sessions.handle(id, EventTimedOut, now));
+
+    // a new session cancels the open one, whose late events are then ignored
+    id = sessions.begin("sms", "+46705", false, now);
+    int64_t next = sessions.begin("sms", "+46706", false, now);
+    CHECK(!sessions.handle(id, EventInitiated, now));
+    CHECK(sessions.current().id == next);
+    sessions.cancel();
+    CHECK(sessions.current().id == 0);
+    sessions.countRateLimited();
+
+    Metrics metrics = sessions.metrics();
+    CHECK(metrics.initiations == 6);
+    CHECK(metrics.verified == 2);
+    CHECK(metrics.failed == 2);
+    CHECK(metrics.timedOut == 1);
+    CHECK(metrics.cancelled == 2);
+    CHECK(metrics.rateLimited == 1);
+    CHECK(metrics.meanLatencyMs == 200);
+    CHECK(metrics.maxLatencyMs == 300);
+}
+
+static bool formatSwedish(const std::string &raw, const std::string &region, std::string &e164) {
+    if (region != "SE" || raw.size() < 2 || raw[0] != '0') {
+        return false;
+    }
+    e164 = "+46" + raw.substr(1);
+    return true;
+}
+
+static void testCorePrepare() {
+    Core core;
+    core.limiter.setLimit(1, std::chrono::minutes(10));
+
+    Prepared prepared = core.prepare("sms", "", "SE", "", false, formatSwedish);
+    CHECK(prepared.status == PrepareInvalidNumber);
+    prepared = core.prepare("sms", "123", "SE", "", false, formatSwedish);
+    CHECK(prepared.status == PrepareInvalidNumber);
+    // the preferred region wins over the device's one, in any case
+    prepared = core.prepare("sms", "0701", "se", "US", false, formatSwedish);
+    CHECK(prepared.status == PrepareOk);
+    CHECK(prepared.phoneNumber == "+46701");
+    CHECK(core.sessions.current().id == prepared.sessionId);
+    // device region fallback, served from the cache this time
+    prepared = core.prepare("sms", "0701", "", "SE", false, formatSwedish);
+    CHECK(prepared.status == PrepareRateLimited);
+
+    Metrics metrics = core.metrics();
+    CHECK(metrics.initiations == 1);
+    CHECK(metrics.rateLimited == 1);
+    CHECK(metrics.cacheHits == 1);
+    CHECK(metrics.cacheMisses == 2);
+}
+
+static void testCoreResume() {
+    const std::string path = "sinch_verification_core_test.session";
+    std::remove(path.c_str());
+    int64_t id;
+    {
+        Core core;
+        core.setStoragePath(path);
+        CHECK(core.resume().status == ResumeNone);
+
+        id = core.prepare("sms", "0701", "SE", "", true, formatSwedish).sessionId;
+        CHECK(core.resume().status == ResumeInFlight);
+        CHECK(core.handle(id, EventInitiated));
+        CHECK(core.resume().status == ResumeInFlight);
+        CHECK(core.handle(id, EventVerificationFailed));
+        Resume resume = core.resume();
+        CHECK(resume.status == ResumeInitiated);
+        CHECK(resume.method == "sms");
+        CHECK(resume.phoneNumber == "+46701");
+        CHECK(core.handle(id, EventVerifying));
+    }
+    {
+        // a new process finds the session it cannot continue
+        Core core;
+        core.setStoragePath(path);
+        Resume resume = core.resume();
+        CHECK(resume.status == ResumeLost);
+        CHECK(resume.phoneNumber == "+46701");
+        CHECK(core.resume().status == ResumeNone);
+
+        id = core.prepare("sms", "0702", "SE", "", false, formatSwedish).sessionId;
+        CHECK(core.handle(id, EventInitiationFailed));
+        Result result;
+        result.code = "timeout";
+        result.message = "timed out\nafter 10ms";
+        core.savePending(result);
+    }
+    {
+        Core core;
+        core.setStoragePath(path);
+        Resume resume = core.resume();
+        CHECK(resume.status == ResumePending);
+        CHECK(!resume.result.success);
+        CHECK(resume.result.code == "timeout");
+        CHECK(resume.result.message == "timed out after 10ms");
+        CHECK(core.resume().status == ResumeNone);
+
+        id = core.prepare("sms", "0703", "SE", "", false, formatSwedish).sessionId;
+        core.savePending(Result());
+        core.reset();
+        CHECK(core.resume().status == ResumeNone);
+        CHECK(!core.handle(id, EventInitiated));
+        CHECK(core.metrics().cancelled == 1);
+    }
+    {
+        Core core;
+        core.setStoragePath(path);
+        CHECK(core.resume().status == ResumeNone);
+    }
+    std::remove(path.c_str());
+}
+
+int main() {
+    testNumberCacheEviction();
+    testNumberCachePromotion();
+    testRateLimiterWindow();
+    testRateLimiterPrune();
+    testSessionTransitions();
+    testCorePrepare();
+    testCoreResume();
+    if (failures) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("all tests passed\n");
+    return 0;
+}
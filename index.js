@@ -7,7 +7,7 @@ var SinchVerificationAndroid = NativeModules.SinchVerificationAndroid;
 
 var SinchVerification;
 if (Platform.OS === 'ios') {
-    invariant(SinchVerificationIOS, 'Add SinchVerificationIOS.h and SinchVerificationIOS.m to your Xcode project');
+    invariant(SinchVerificationIOS, 'Add the SinchVerificationIOS and cpp/core folders (SinchVerificationIOS.mm and the shared C++ core) to your Xcode project');
     SinchVerification = SinchVerificationIOS;
 } else if (Platform.OS === 'android') {
     invariant(SinchVerificationAndroid, 'Import libraries to android "rnpm link"');
@@ -17,23 +17,64 @@ if (Platform.OS === 'ios') {
 }
 
 var applicationKey = null;
+var defaultRegion = null;
 
 module.exports = {
 	
-	init: function(appKey) {
+	// options.defaultRegion: ISO country code for numbers without a country code, defaults to the device's region
+	init: function(appKey, options) {
 		applicationKey = appKey;
+		defaultRegion = (options && options.defaultRegion) || null;
 	},
 	
-	sms: function(phoneNumber, custom, callback) {
+	// timeout is optional, in milliseconds
+	sms: function(phoneNumber, custom, callback, timeout) {
 		invariant(applicationKey, 'Call init() to setup the Sinch application key.');
-		SinchVerification.sms(applicationKey, phoneNumber, custom, callback);
+		SinchVerification.sms(applicationKey, phoneNumber, custom, defaultRegion, timeout || 0, callback);
 	},
 	
-	flashCall: function(phoneNumber, custom, callback) {
+	flashCall: function(phoneNumber, custom, callback, timeout) {
 		invariant(applicationKey, 'Call init() to setup the Sinch application key.');
-		SinchVerification.flashCall(applicationKey, phoneNumber, custom, callback);
+		SinchVerification.flashCall(applicationKey, phoneNumber, custom, defaultRegion, timeout || 0, callback);
 	},
 	
-	verify: SinchVerification.verify,
+	verify: function(code, callback, timeout) {
+		SinchVerification.verify(code, timeout || 0, callback);
+	},
+	
+	// drops the current verification
+	reset: function(callback) {
+		SinchVerification.reset(callback);
+	},
+	
+	// at most maxAttempts sms / flash calls per number within windowMs, 0 disables the limit
+	setRateLimit: function(maxAttempts, windowMs, callback) {
+		SinchVerification.setRateLimit(maxAttempts || 0, windowMs || 0, callback || function() {});
+	},
+	
+	// session counts, latency and number cache statistics of this process
+	metrics: function(callback) {
+		SinchVerification.metrics(callback);
+	},
+	
+	// picks up a verification started before the JS context was reloaded
+	resume: function(callback) {
+		SinchVerification.resume(callback);
+	},
+	
+	// example numbers for every region, as {"US": {e164, international, national}, ...} (ios only)
+	exampleNumbers: function(callback) {
+		SinchVerification.exampleNumbers(callback);
+	},
+	
+	// start (enabled = true) or stop recording SDK callbacks, callback receives the recording file path
+	record: function(enabled, callback) {
+		SinchVerification.record(enabled, callback);
+	},
+	
+	// replay a recording against the bridge, speed 1 is the original pace, 0 is as fast as possible
+	replay: function(path, speed, callback) {
+		SinchVerification.replay(path, speed || 0, callback);
+	},
 	
 }
\ No newline at end of file